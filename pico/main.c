@@ -2,10 +2,21 @@
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
 #include "pico/time.h"
+#include "pico/unique_id.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/systick.h"
 
 #define EVENT_QUEUE_SIZE 128  // must be a power of two (128, 256, 512...)
 #define PRESS_INTERVAL_MS 35  // interval between actuations
 #define PRESS_DURATION_MS 5   // how long the pin stays "active"
+#define TX_BATCH_BYTES 1024   // text assembled per USB write
+#define TX_LINE_MAX 48        // worst-case length of one event/heartbeat line (also fits the batch tag)
+#define TX_LOAD_LINE_MAX 192  // worst-case length of one load report line
+#define TX_HELLO_LINE_MAX 256 // worst-case length of the hello line (all 30 GPIOs)
+#define CMD_LINE_MAX 32       // longest host command accepted on stdin
+#define PROTO_VERSION 1       // bump when a line format changes
 
 //Erste Messung mit Bildern von Osci war im bereich 15 und 5 us bilder: 0-3
 //Zweite Messung mit bidern 1500 und 500 us bild 4 => ein Pulsweiter trigger außerhalb der erlaubten Periodendauer wurde gesetzt. Dieser wurden nach 10t durchgängen nicht ausgelöst scope 4 
@@ -47,6 +58,371 @@ static inline bool queue_pop(event_t* out) {
     return true;
 }
 
+// ---- ASCII output: hand-rolled formatting + batched writes ----
+// printf("%llu") pulls in a software 64-bit division per digit on the M0+.
+// Digits are produced by subtracting powers of ten instead, and all lines of
+// one drain pass go out with a single stdio_put_string call. The text stays
+// byte-for-byte identical to the old printf output ("<us> us GPIO<n>").
+
+static const uint64_t pow10_u64[20] = {
+    10000000000000000000ull, 1000000000000000000ull, 100000000000000000ull,
+    10000000000000000ull, 1000000000000000ull, 100000000000000ull,
+    10000000000000ull, 1000000000000ull, 100000000000ull, 10000000000ull,
+    1000000000ull, 100000000ull, 10000000ull, 1000000ull, 100000ull,
+    10000ull, 1000ull, 100ull, 10ull, 1ull
+};
+
+// Writes v in decimal without leading zeros, returns the end pointer.
+static char* fmt_u64(char* p, uint64_t v) {
+    size_t i = 0;
+    while (i < 19 && v < pow10_u64[i]) i++;   // skip leading zeros
+    for (; i < 20; i++) {
+        const uint64_t step = pow10_u64[i];
+        char d = '0';
+        while (v >= step) { v -= step; d++; }
+        *p++ = d;
+    }
+    return p;
+}
+
+static char tx_buf[TX_BATCH_BYTES];
+static size_t tx_len = 0;
+
+// Every batch starts with "Batch=<seq> Board=<id>" so a host reading several
+// Picos can attribute each chunk even if it missed the session header.
+static char board_id[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+static uint32_t batch_seq = 0;
+
+static void tx_flush(void) {
+    if (tx_len == 0) return;
+    stdio_put_string(tx_buf, (int)tx_len, false, true);  // same CRLF handling as printf
+    tx_len = 0;
+}
+
+static inline void tx_append_str(char** p, const char* s) {
+    while (*s) *(*p)++ = *s++;
+}
+
+// Makes sure a line of up to line_max bytes fits; flushes the current batch
+// otherwise and opens a new one with its tag line.
+static char* tx_reserve(size_t line_max) {
+    if (tx_len + line_max > TX_BATCH_BYTES) tx_flush();
+    if (tx_len == 0) {
+        char* p = tx_buf;
+        tx_append_str(&p, "Batch=");
+        p = fmt_u64(p, batch_seq++);
+        tx_append_str(&p, " Board=");
+        tx_append_str(&p, board_id);
+        *p++ = '\n';
+        tx_len = (size_t)(p - tx_buf);
+    }
+    return tx_buf + tx_len;
+}
+
+// "<us> us GPIO<n>\n"
+static void tx_event(const event_t* ev) {
+    char* p = tx_reserve(TX_LINE_MAX);
+    char* start = p;
+    p = fmt_u64(p, ev->ts_us);
+    tx_append_str(&p, " us GPIO");
+    p = fmt_u64(p, ev->gpio);
+    *p++ = '\n';
+    tx_len += (size_t)(p - start);
+}
+
+// "Heartbeat. Dropped=<n>\n"
+static void tx_heartbeat(uint32_t dropped_count) {
+    char* p = tx_reserve(TX_LINE_MAX);
+    char* start = p;
+    tx_append_str(&p, "Heartbeat. Dropped=");
+    p = fmt_u64(p, dropped_count);
+    *p++ = '\n';
+    tx_len += (size_t)(p - start);
+}
+
+// ---- Loop-phase accounting ----
+// The M0+ has no DWT cycle counter, but each core has its own 24-bit SysTick.
+// It is run free at clk_sys and every main-loop step charges the cycles since
+// the previous mark to one phase. A step that found nothing to do is charged
+// to IDLE, so the phases always add up to the wall time of the window.
+// SysTick wraps after 2^24 cycles (~134 ms at 125 MHz); a step that long (USB
+// stall, flash erase) is charged from time_us_64() instead and counted in
+// long=, so its cycles are microsecond-accurate rather than taken mod 2^24.
+
+enum {
+    PHASE_SCHEDULE,   // actuation incl. the pulse hold
+    PHASE_DRAIN,      // queue pop + formatting
+    PHASE_USB,        // handing the batch to stdio (USB stalls land here)
+    PHASE_HEARTBEAT,  // heartbeat + load report
+    PHASE_COMMAND,    // host commands (sync, calibration)
+    PHASE_IDLE,
+    PHASE_COUNT
+};
+
+static const char* const phase_names[PHASE_COUNT] = {
+    " sched=", " drain=", " usb=", " hb=", " cmd=", " idle="
+};
+
+typedef struct {
+    bool     started;
+    uint32_t last;                 // SysTick value at the previous mark
+    uint32_t loop_start;           // SysTick value at the top of the loop
+    uint64_t last_us;              // time_us_64() at the previous mark
+    uint64_t loop_start_us;
+    uint32_t cycles_per_us;        // clk_sys / 1 MHz
+    uint32_t wrap_us;              // SysTick period in us, rounded down
+    uint32_t max_loop;             // longest loop iteration in this window
+    uint32_t long_steps;           // steps timed by time_us_64() in this window
+    uint32_t cycles[PHASE_COUNT];  // per window, fits 32 bits for a 1 s window
+} loop_stats_t;
+
+static loop_stats_t loop_stats[2];  // one per core
+
+#define SYSTICK_MASK 0x00FFFFFFu
+
+static void loop_stats_init(void) {
+    loop_stats_t* st = &loop_stats[get_core_num()];
+    systick_hw->rvr = SYSTICK_MASK;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;          // enable, processor clock, no interrupt
+    st->cycles_per_us = clock_get_hz(clk_sys) / 1000000u;
+    if (st->cycles_per_us == 0) st->cycles_per_us = 1;
+    st->wrap_us = (SYSTICK_MASK + 1u) / st->cycles_per_us;
+    st->last = systick_hw->cvr;
+    st->last_us = time_us_64();
+    st->loop_start = st->last;
+    st->loop_start_us = st->last_us;
+    st->started = true;
+}
+
+// Cycles between two marks. SysTick counts down; once the microsecond clock
+// says it may have wrapped, the microsecond count is used instead.
+static inline uint32_t elapsed_cycles(const loop_stats_t* st, uint32_t from, uint32_t to,
+                                      uint64_t from_us, uint64_t to_us, bool* wrapped) {
+    uint64_t us = to_us - from_us;
+    if (us + 1 >= st->wrap_us) {
+        uint64_t cycles = us * st->cycles_per_us;
+        *wrapped = true;
+        return cycles > UINT32_MAX ? UINT32_MAX : (uint32_t)cycles;
+    }
+    *wrapped = false;
+    return (from - to) & SYSTICK_MASK;
+}
+
+static inline void phase_mark(loop_stats_t* st, int phase) {
+    uint32_t now = systick_hw->cvr;
+    uint64_t now_us = time_us_64();
+    bool wrapped;
+    st->cycles[phase] += elapsed_cycles(st, st->last, now, st->last_us, now_us, &wrapped);
+    if (wrapped) st->long_steps++;
+    st->last = now;
+    st->last_us = now_us;
+}
+
+static inline void loop_mark_end(loop_stats_t* st) {
+    bool wrapped;
+    uint32_t len = elapsed_cycles(st, st->loop_start, st->last, st->loop_start_us, st->last_us, &wrapped);
+    if (len > st->max_loop) st->max_loop = len;
+    st->loop_start = st->last;
+    st->loop_start_us = st->last_us;
+}
+
+// "Load core=<n> total=<cycles> sched=.. drain=.. usb=.. hb=.. idle=.. max_loop=<cycles> long=<n>"
+static void tx_load_report(void) {
+    for (unsigned core = 0; core < 2; core++) {
+        loop_stats_t* st = &loop_stats[core];
+        if (!st->started) continue;
+
+        uint32_t snap[PHASE_COUNT];
+        uint32_t total = 0;
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            snap[i] = st->cycles[i];
+            st->cycles[i] = 0;
+            total += snap[i];
+        }
+        uint32_t max_loop = st->max_loop;
+        st->max_loop = 0;
+        uint32_t long_steps = st->long_steps;
+        st->long_steps = 0;
+
+        char* p = tx_reserve(TX_LOAD_LINE_MAX);
+        char* start = p;
+        tx_append_str(&p, "Load core=");
+        p = fmt_u64(p, core);
+        tx_append_str(&p, " total=");
+        p = fmt_u64(p, total);
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            tx_append_str(&p, phase_names[i]);
+            p = fmt_u64(p, snap[i]);
+        }
+        tx_append_str(&p, " max_loop=");
+        p = fmt_u64(p, max_loop);
+        tx_append_str(&p, " long=");
+        p = fmt_u64(p, long_steps);
+        *p++ = '\n';
+        tx_len += (size_t)(p - start);
+    }
+}
+
+// ---- Crystal-drift calibration ----
+// The host measures the Pico clock against its own monotonic clock through
+// repeated "SYNC" requests (answered with "Sync=<us>") and stores the result
+// with "CAL ppb=<n>". The correction lives in the last flash sector and is
+// announced as "Calibration ppb=<n>" in the session header; event timestamps
+// stay raw so the host decides how to apply it.
+// ppb > 0 means the Pico clock runs fast: true_us = raw_us / (1 + ppb * 1e-9).
+
+#define CAL_MAGIC 0x4C414331u  // "CAL1"
+#define CAL_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+
+typedef struct {
+    uint32_t magic;
+    int32_t  ppb;
+    uint32_t check;            // ~ppb, guards against a half-written record
+} cal_record_t;
+
+static bool cal_valid = false;
+static int32_t cal_ppb = 0;
+
+static void cal_load(void) {
+    const cal_record_t* rec = (const cal_record_t*)(XIP_BASE + CAL_FLASH_OFFSET);
+    cal_valid = rec->magic == CAL_MAGIC && rec->check == ~(uint32_t)rec->ppb;
+    cal_ppb = cal_valid ? rec->ppb : 0;
+}
+
+static void cal_program(void* param) {
+    static uint8_t page[FLASH_PAGE_SIZE];
+    const cal_record_t* rec = (const cal_record_t*)param;
+    for (size_t i = 0; i < sizeof(page); i++) page[i] = 0xFF;
+    for (size_t i = 0; i < sizeof(*rec); i++) page[i] = ((const uint8_t*)rec)[i];
+    flash_range_erase(CAL_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(CAL_FLASH_OFFSET, page, FLASH_PAGE_SIZE);
+}
+
+static bool cal_store(int32_t ppb) {
+    cal_record_t rec = { CAL_MAGIC, ppb, ~(uint32_t)ppb };
+    if (flash_safe_execute(cal_program, &rec, 100) != PICO_OK) return false;
+    cal_load();
+    return cal_valid && cal_ppb == ppb;
+}
+
+// "Calibration ppb=<n>" or "Calibration none"
+static void tx_calibration(void) {
+    char* p = tx_reserve(TX_LINE_MAX);
+    char* start = p;
+    tx_append_str(&p, "Calibration ");
+    if (cal_valid) {
+        tx_append_str(&p, "ppb=");
+        if (cal_ppb < 0) *p++ = '-';
+        p = fmt_u64(p, cal_ppb < 0 ? (uint64_t)(-(int64_t)cal_ppb) : (uint64_t)cal_ppb);
+    } else {
+        tx_append_str(&p, "none");
+    }
+    *p++ = '\n';
+    tx_len += (size_t)(p - start);
+}
+
+// ---- Protocol hello ----
+// Describes this firmware so the host does not have to guess from the banner:
+//   Hello proto=<n> enc=text fw=<name> board=<id> pins=<a,b,..>
+//         interval_ms=<n> pulse_ms=<n> queue=<n> clock=us
+// Sent in the session header and again on "HELLO", so a host that attaches
+// to a running Pico gets it too. Hosts that do not know it see an INFO line.
+
+static void tx_hello(void) {
+    char* p = tx_reserve(TX_HELLO_LINE_MAX);
+    char* start = p;
+    tx_append_str(&p, "Hello proto=");
+    p = fmt_u64(p, PROTO_VERSION);
+    tx_append_str(&p, " enc=text fw=multi-gpio-actuator board=");
+    tx_append_str(&p, board_id);
+    tx_append_str(&p, " pins=");
+    for (size_t i = 0; i < NUM_PINS; i++) {
+        if (i > 0) *p++ = ',';
+        p = fmt_u64(p, press_pins[i]);
+    }
+    tx_append_str(&p, " interval_ms=");
+    p = fmt_u64(p, PRESS_INTERVAL_MS);
+    tx_append_str(&p, " pulse_ms=");
+    p = fmt_u64(p, PRESS_DURATION_MS);
+    tx_append_str(&p, " queue=");
+    p = fmt_u64(p, EVENT_QUEUE_SIZE);
+    tx_append_str(&p, " clock=us\n");
+    tx_len += (size_t)(p - start);
+}
+
+// ---- Host commands on stdin ----
+
+static char cmd_buf[CMD_LINE_MAX];
+static size_t cmd_len = 0;
+
+static bool parse_i32(const char* s, int32_t* out) {
+    bool neg = false;
+    int64_t v = 0;
+    if (*s == '-') { neg = true; s++; }
+    if (*s < '0' || *s > '9') return false;
+    while (*s >= '0' && *s <= '9') {
+        v = v * 10 + (*s++ - '0');
+        if (v > 0x7FFFFFFF) return false;
+    }
+    if (*s != '\0') return false;
+    *out = (int32_t)(neg ? -v : v);
+    return true;
+}
+
+static void handle_command(const char* cmd) {
+    if (cmd[0] == 'S' && cmd[1] == 'Y' && cmd[2] == 'N' && cmd[3] == 'C' && cmd[4] == '\0') {
+        // Answer right away: the host measures the round trip
+        char* p = tx_reserve(TX_LINE_MAX);
+        char* start = p;
+        tx_append_str(&p, "Sync=");
+        p = fmt_u64(p, time_us_64());
+        *p++ = '\n';
+        tx_len += (size_t)(p - start);
+        tx_flush();
+        return;
+    }
+    if (cmd[0] == 'H' && cmd[1] == 'E' && cmd[2] == 'L' && cmd[3] == 'L' && cmd[4] == 'O' &&
+        cmd[5] == '\0') {
+        tx_hello();
+        return;
+    }
+    const char* cal = "CAL ppb=";
+    size_t i = 0;
+    while (cal[i] && cmd[i] == cal[i]) i++;
+    if (cal[i] == '\0') {
+        int32_t ppb;
+        if (parse_i32(cmd + i, &ppb) && cal_store(ppb)) {
+            tx_calibration();
+        } else {
+            char* p = tx_reserve(TX_LINE_MAX);
+            char* start = p;
+            tx_append_str(&p, "Calibration failed\n");
+            tx_len += (size_t)(p - start);
+        }
+    }
+}
+
+// Non-blocking: consumes whatever the host has sent so far.
+static bool poll_commands(void) {
+    bool any = false;
+    int c;
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+        any = true;
+        if (c == '\r') continue;
+        if (c == '\n') {
+            cmd_buf[cmd_len] = '\0';
+            if (cmd_len > 0) handle_command(cmd_buf);
+            cmd_len = 0;
+        } else if (cmd_len + 1 < CMD_LINE_MAX) {
+            cmd_buf[cmd_len++] = (char)c;
+        } else {
+            cmd_len = 0;   // overlong line, drop it
+        }
+    }
+    return any;
+}
+
 int main() {
     stdio_init_all();
     sleep_ms(10000);  // allow USB host to connect
@@ -58,8 +434,15 @@ int main() {
         gpio_put(press_pins[i], 0);
     }
 
+    pico_get_unique_board_id_string(board_id, sizeof(board_id));
+    cal_load();
+
     printf("Pico multi-GPIO actuator started. Interval=%d ms, duration=%d ms\n",
            PRESS_INTERVAL_MS, PRESS_DURATION_MS);
+    printf("Board=%s\n", board_id);
+    tx_hello();
+    tx_calibration();
+    tx_flush();
 
     absolute_time_t next_press = make_timeout_time_ms(PRESS_INTERVAL_MS);
     absolute_time_t next_heartbeat = make_timeout_time_ms(1000);
@@ -68,8 +451,12 @@ int main() {
 
     //int ctr = 0;
 
+    loop_stats_init();
+    loop_stats_t* st = &loop_stats[get_core_num()];
+
     while (true) {
         // Handle periodic actuation
+        phase_mark(st, PHASE_IDLE);
         if (absolute_time_diff_us(get_absolute_time(), next_press) <= 0) {
             uint8_t pin = press_pins[pin_index];
             uint64_t ts = time_us_64();
@@ -87,22 +474,36 @@ int main() {
 
             // schedule next
             next_press = delayed_by_ms(next_press, PRESS_INTERVAL_MS);
+            phase_mark(st, PHASE_SCHEDULE);
         }
 
-        // Drain log buffer to serial
+        // Drain log buffer into the batch
         event_t ev;
+        bool drained = false;
         while (queue_pop(&ev)) {
-            printf("%llu us GPIO%u\n",
-                   (unsigned long long)ev.ts_us,
-                   (unsigned)ev.gpio);
+            tx_event(&ev);
+            drained = true;
         }
+        phase_mark(st, drained ? PHASE_DRAIN : PHASE_IDLE);
 
         // Periodic heartbeat
         if (absolute_time_diff_us(get_absolute_time(), next_heartbeat) <= 0) {
-            printf("Heartbeat. Dropped=%lu\n", (unsigned long)dropped);
+            tx_heartbeat(dropped);
+            tx_load_report();
             next_heartbeat = delayed_by_ms(next_heartbeat, 1000);
+            phase_mark(st, PHASE_HEARTBEAT);
+        }
+
+        // Host commands
+        phase_mark(st, poll_commands() ? PHASE_COMMAND : PHASE_IDLE);
+
+        // One USB write for everything collected in this pass
+        if (tx_len > 0) {
+            tx_flush();
+            phase_mark(st, PHASE_USB);
         }
 
+        loop_mark_end(st);
         tight_loop_contents();
     }
 }
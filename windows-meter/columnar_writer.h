@@ -0,0 +1,195 @@
+// columnar_writer.h
+// Binary columnar session file, little-endian, meant to be memory-mapped.
+//
+//   [0, header_bytes)   ColumnarFileHeader + metadata text (key=value lines),
+//                       zero padded; rewritten with final totals on close
+//   then block_count blocks of exactly block_bytes each:
+//     ColumnarBlockHeader (32 bytes)
+//     arrival_ns  u64[block_rows]   host monotonic ns of the read
+//     pico_us     i64[block_rows]   Pico us (DATA/SYNC), Dropped= (HEARTBEAT),
+//                                   ppb (CAL), -1 if none
+//     seq         u32[block_rows]   firmware batch sequence, 0xFFFFFFFF if unknown
+//     segment     u16[block_rows]   clock segment
+//     gpio        i8 [block_rows]   -1 if none
+//     type        u8 [block_rows]   row type (see serial_logger.cpp)
+//     device      u8 [block_rows]   index into the "device" metadata lines
+//
+// Every block has the same size, so block i starts at
+// header_bytes + i * block_bytes; only the last one may hold fewer than
+// block_rows rows (ColumnarBlockHeader::rows). The open block is rewritten in
+// place on every flush, so a crash loses at most one flush interval.
+// Offsets are 64-bit (_fseeki64 / fseeko), so files may exceed 2 GB.
+// Metadata longer than the header holds is cut at a line end and ends with a
+// "meta_truncated=<full length>" line.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+// Absolute seek with a 64-bit offset; false on failure or if the offset
+// does not fit the platform's file offset type
+static inline bool columnar_seek(std::FILE* f, uint64_t offset) {
+#ifdef _WIN32
+    if (offset > (uint64_t)INT64_MAX) return false;
+    return _fseeki64(f, (long long)offset, SEEK_SET) == 0;
+#else
+    if (sizeof(off_t) < 8 && offset > (uint64_t)INT32_MAX) return false;
+    return fseeko(f, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+struct ColumnarFileHeader {
+    char     magic[8];        // "PICOCOL\0"
+    uint32_t version;         // 1
+    uint32_t header_bytes;    // blocks start here
+    uint32_t block_rows;      // row capacity of every block
+    uint32_t block_bytes;
+    uint64_t total_rows;      // valid after close
+    uint32_t block_count;     // valid after close
+    uint32_t meta_bytes;      // metadata text right after this header
+    uint8_t  reserved[24];
+};
+static_assert(sizeof(ColumnarFileHeader) == 64, "file header layout");
+
+struct ColumnarBlockHeader {
+    char     magic[4];        // "BLK1"
+    uint32_t rows;
+    uint64_t first_arrival_ns;
+    uint64_t last_arrival_ns;
+    uint64_t reserved;
+};
+static_assert(sizeof(ColumnarBlockHeader) == 32, "block header layout");
+
+struct ColumnarRow {
+    uint64_t arrival_ns;
+    int64_t  pico_us;
+    uint32_t seq;
+    uint16_t segment;
+    int8_t   gpio;
+    uint8_t  type;
+    uint8_t  device;
+};
+
+class ColumnarWriter {
+public:
+    static constexpr uint32_t kHeaderBytes = 4096;
+    static constexpr uint32_t kBlockRows = 1024;   // keep a multiple of 8
+    static constexpr size_t kMetaMax = kHeaderBytes - sizeof(ColumnarFileHeader);
+
+    // Takes over f (opened "wb"); the metadata can be replaced on close.
+    bool open(std::FILE* f, const std::string& meta) {
+        f_ = f;
+        block_.assign(block_bytes(), 0);
+        rows_ = 0;
+        full_blocks_ = 0;
+        failed_ = false;
+        return write_header(meta);
+    }
+
+    void add(const ColumnarRow& r) {
+        uint8_t* b = block_.data() + sizeof(ColumnarBlockHeader);
+        const size_t i = rows_;
+        std::memcpy(b + i * 8, &r.arrival_ns, 8);
+        b += (size_t)kBlockRows * 8;
+        std::memcpy(b + i * 8, &r.pico_us, 8);
+        b += (size_t)kBlockRows * 8;
+        std::memcpy(b + i * 4, &r.seq, 4);
+        b += (size_t)kBlockRows * 4;
+        std::memcpy(b + i * 2, &r.segment, 2);
+        b += (size_t)kBlockRows * 2;
+        b[i] = (uint8_t)r.gpio;
+        b += kBlockRows;
+        b[i] = r.type;
+        b += kBlockRows;
+        b[i] = r.device;
+
+        if (rows_ == 0) first_arrival_ns_ = r.arrival_ns;
+        last_arrival_ns_ = r.arrival_ns;
+        if (++rows_ == kBlockRows) {
+            if (!write_block()) failed_ = true;
+            full_blocks_++;
+            rows_ = 0;
+            std::memset(block_.data(), 0, block_.size());
+        }
+    }
+
+    // Writes the open block in place and flushes the file; false once any
+    // write has failed
+    bool flush() {
+        if (rows_ > 0 && !write_block()) failed_ = true;
+        if (std::fflush(f_) != 0) failed_ = true;
+        return !failed_;
+    }
+
+    bool close(const std::string& meta) {
+        flush();
+        if (!write_header(meta)) failed_ = true;
+        if (std::fflush(f_) != 0) failed_ = true;
+        return !failed_;
+    }
+
+    uint64_t total_rows() const { return (uint64_t)full_blocks_ * kBlockRows + rows_; }
+
+    static constexpr size_t block_bytes() {
+        return sizeof(ColumnarBlockHeader) + (size_t)kBlockRows * (8 + 8 + 4 + 2 + 1 + 1 + 1);
+    }
+
+private:
+    bool write_header(const std::string& meta) {
+        ColumnarFileHeader h{};
+        std::memcpy(h.magic, "PICOCOL", 8);
+        h.version = 1;
+        h.header_bytes = kHeaderBytes;
+        h.block_rows = kBlockRows;
+        h.block_bytes = (uint32_t)block_bytes();
+        h.total_rows = total_rows();
+        h.block_count = full_blocks_ + (rows_ > 0 ? 1u : 0u);
+
+        const std::string text = fit_meta(meta);
+        std::vector<char> buf(kHeaderBytes, 0);
+        h.meta_bytes = (uint32_t)text.size();
+        std::memcpy(buf.data(), &h, sizeof(h));
+        std::memcpy(buf.data() + sizeof(h), text.data(), text.size());
+
+        return columnar_seek(f_, 0) &&
+               std::fwrite(buf.data(), 1, buf.size(), f_) == buf.size();
+    }
+
+    static std::string fit_meta(const std::string& meta) {
+        if (meta.size() <= kMetaMax) return meta;
+        const std::string mark = "meta_truncated=" + std::to_string(meta.size()) + "\n";
+        size_t keep = kMetaMax - mark.size();
+        const size_t nl = meta.rfind('\n', keep - 1);
+        keep = nl == std::string::npos ? 0 : nl + 1;
+        return meta.substr(0, keep) + mark;
+    }
+
+    bool write_block() {
+        ColumnarBlockHeader bh{};
+        std::memcpy(bh.magic, "BLK1", 4);
+        bh.rows = rows_;
+        bh.first_arrival_ns = first_arrival_ns_;
+        bh.last_arrival_ns = last_arrival_ns_;
+        std::memcpy(block_.data(), &bh, sizeof(bh));
+
+        const uint64_t offset = (uint64_t)kHeaderBytes + (uint64_t)full_blocks_ * block_bytes();
+        return columnar_seek(f_, offset) &&
+               std::fwrite(block_.data(), 1, block_.size(), f_) == block_.size();
+    }
+
+    std::FILE* f_ = nullptr;
+    std::vector<uint8_t> block_;
+    uint32_t rows_ = 0;
+    uint32_t full_blocks_ = 0;
+    uint64_t first_arrival_ns_ = 0;
+    uint64_t last_arrival_ns_ = 0;
+    bool failed_ = false;      // a block or header write failed
+};
@@ -0,0 +1,275 @@
+// debounce.h
+// Key debounce strategies, shared by key_logger (live) and debounce_eval
+// (offline over a keyboard_*_raw.csv). A Debouncer sees the edges of every
+// key (device + event_key_index()) in time order and decides which presses are
+// accepted:
+//  - eager:      accept a DOWN at once, then ignore DOWNs until threshold
+//                after it (leading edge; the original key_logger filter)
+//  - deferred:   accept once the key has stayed down for threshold without
+//                any edge (trailing edge)
+//  - integrator: a time integrator that rises while the key is down and
+//                falls while it is up, clamped to [0, threshold]; accept
+//                when it reaches threshold, release when it reaches 0
+// Any strategy takes per-key thresholds on top of its default.
+//
+// Deferred and integrator decide after the fact: when a later edge arrives,
+// on tick(now), or on finish(). An accepted press is reported by its onset
+// (the first DOWN since the key was released) plus the time of the decision.
+//
+// Spec text: <kind>:<ms>[,<key>=<ms>...] with key as event_key_index() (make
+// code | 0x100 for E0 | 0x200 for E1; 0x400 + native code for keys without
+// a scan code), e.g. "deferred:8" or "eager:5,0x39=12".
+//
+// debounce_test.cpp drives every strategy through hand-made edge sequences.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "key_codes.h"
+
+enum DebounceKind : uint8_t {
+    kDebounceEager,
+    kDebounceDeferred,
+    kDebounceIntegrator,
+};
+
+static inline const char* debounce_kind_name(DebounceKind k) {
+    switch (k) {
+    case kDebounceEager:      return "eager";
+    case kDebounceDeferred:   return "deferred";
+    case kDebounceIntegrator: return "integrator";
+    }
+    return "?";
+}
+
+struct DebounceSpec {
+    DebounceKind kind = kDebounceEager;
+    uint64_t threshold_ns = 5000000;
+    std::vector<std::pair<uint32_t, uint64_t>> per_key;   // event_key_index(), ns
+};
+
+static inline bool parse_debounce_ms(const char* s, const char* end, uint64_t& ns) {
+    if (s == end) return false;
+    char* stop = nullptr;
+    const double ms = std::strtod(s, &stop);
+    if (stop != end || !(ms >= 0.0) || ms > 10000.0) return false;
+    ns = (uint64_t)(ms * 1e6 + 0.5);
+    return true;
+}
+
+// False on malformed text; out is only written on success
+static inline bool parse_debounce_spec(const std::string& text, DebounceSpec& out) {
+    DebounceSpec spec;
+    const size_t colon = text.find(':');
+    if (colon == std::string::npos) return false;
+    const std::string kind = text.substr(0, colon);
+    if (kind == "eager") spec.kind = kDebounceEager;
+    else if (kind == "deferred") spec.kind = kDebounceDeferred;
+    else if (kind == "integrator") spec.kind = kDebounceIntegrator;
+    else return false;
+
+    const char* p = text.c_str() + colon + 1;
+    const char* end = text.c_str() + text.size();
+    const char* comma = std::strchr(p, ',');
+    if (!comma) comma = end;
+    if (!parse_debounce_ms(p, comma, spec.threshold_ns)) return false;
+
+    while (comma < end) {
+        p = comma + 1;
+        comma = std::strchr(p, ',');
+        if (!comma) comma = end;
+        const char* eq = (const char*)std::memchr(p, '=', (size_t)(comma - p));
+        if (!eq) return false;
+        char* stop = nullptr;
+        const unsigned long key = std::strtoul(p, &stop, 0);
+        uint64_t ns = 0;
+        if (stop == p || stop != eq || key >= kKeyIndexCount || !parse_debounce_ms(eq + 1, comma, ns)) return false;
+        spec.per_key.emplace_back((uint32_t)key, ns);
+    }
+    out = spec;
+    return true;
+}
+
+static inline std::string format_debounce_spec(const DebounceSpec& spec) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%s:%g", debounce_kind_name(spec.kind),
+                  (double)spec.threshold_ns * 1e-6);
+    std::string s = buf;
+    for (const auto& k : spec.per_key) {
+        std::snprintf(buf, sizeof(buf), ",0x%x=%g", (unsigned)k.first, (double)k.second * 1e-6);
+        s += buf;
+    }
+    return s;
+}
+
+// Payload is what an accepted press is reported with (a KeyEvent live, a
+// row number offline). Devices are interned into slots on first sight; each
+// slot holds a dense, cache-line aligned state array indexed by event_key_index(),
+// so a lookup is a short scan over the (few) devices plus one indexed load,
+// and keys of different devices never share state.
+template <class Payload>
+class Debouncer {
+public:
+    static constexpr uint64_t kNever = UINT64_MAX;
+
+    Debouncer() : Debouncer(DebounceSpec()) {}
+
+    explicit Debouncer(const DebounceSpec& spec) : spec_(spec), threshold_(kKeyIndexCount, spec.threshold_ns) {
+        for (const auto& k : spec.per_key) threshold_[k.first % kKeyIndexCount] = k.second;
+    }
+
+    const DebounceSpec& spec() const { return spec_; }
+
+    // One edge, in time order. Autorepeat (DOWN while down) is ignored.
+    // Calls fn(const Payload& onset, uint64_t onset_ns, uint64_t decided_ns)
+    // for every press accepted up to t_ns.
+    template <class Fn>
+    void edge(uint64_t device, uint32_t key, bool down, uint64_t t_ns, const Payload& p, Fn&& fn) {
+        key %= kKeyIndexCount;
+        DeviceKeys& d = slot(device);
+        KeyState& s = d.keys[key];
+        const uint64_t T = threshold_[key];
+        resolve(s, t_ns, T, fn);
+
+        if (spec_.kind == kDebounceEager) {
+            if (!down) {
+                // UP: update state but never report
+                s.stable_down = false;
+            } else if (!s.stable_down && (!s.accepted_once || t_ns - s.last_accept_ns >= T)) {
+                s.stable_down = true;
+                s.accepted_once = true;
+                s.last_accept_ns = t_ns;
+                fn(p, t_ns, t_ns);
+            }
+            s.raw_down = down;
+            return;
+        }
+
+        if (down == s.raw_down) return;
+        if (down) {
+            // A press starts with the first DOWN after the key was up for threshold
+            if (!s.stable_down && (!s.has_onset || t_ns - s.last_up_ns >= T)) {
+                s.onset = p;
+                s.onset_ns = t_ns;
+                s.has_onset = true;
+            }
+        } else {
+            s.last_up_ns = t_ns;
+        }
+        if (spec_.kind == kDebounceIntegrator) integrate(s, t_ns, T);
+        s.raw_down = down;
+
+        schedule(s, t_ns, T);
+        if (s.deadline_ns != kNever && !s.queued) {
+            s.queued = true;
+            pending_.push_back(PendingKey{ &d, key });
+        }
+        resolve(s, t_ns, T, fn);
+    }
+
+    // Decides every key whose decision time is <= now_ns
+    template <class Fn>
+    void tick(uint64_t now_ns, Fn&& fn) {
+        size_t i = 0;
+        while (i < pending_.size()) {
+            KeyState& s = pending_[i].device->keys[pending_[i].key];
+            resolve(s, now_ns, threshold_[pending_[i].key], fn);
+            if (s.deadline_ns == kNever) {
+                s.queued = false;
+                pending_[i] = pending_.back();
+                pending_.pop_back();
+            } else {
+                i++;
+            }
+        }
+    }
+
+    // End of the stream: let time run on for every key
+    template <class Fn>
+    void finish(Fn&& fn) { tick(kNever - 1, fn); }
+
+private:
+    struct KeyState {
+        uint64_t last_accept_ns = 0;    // eager
+        uint64_t last_up_ns = 0;
+        uint64_t integ_ns = 0;          // integrator level, 0..threshold
+        uint64_t integ_at_ns = 0;       // time integ_ns refers to
+        uint64_t deadline_ns = kNever;  // next decision, if undisturbed
+        uint64_t onset_ns = 0;
+        Payload onset{};
+        bool raw_down = false;
+        bool stable_down = false;
+        bool accepted_once = false;
+        bool has_onset = false;
+        bool queued = false;            // listed in pending_
+    };
+
+    struct alignas(64) DeviceKeys {
+        KeyState keys[kKeyIndexCount];
+        uint64_t device = 0;
+    };
+
+    struct PendingKey {
+        DeviceKeys* device;
+        uint32_t key;
+    };
+
+    // An edge older than the last decision (late to arrive) integrates nothing
+    static void integrate(KeyState& s, uint64_t t_ns, uint64_t T) {
+        const uint64_t dt = t_ns > s.integ_at_ns ? t_ns - s.integ_at_ns : 0;
+        if (s.raw_down) s.integ_ns = T - s.integ_ns > dt ? s.integ_ns + dt : T;
+        else s.integ_ns = s.integ_ns > dt ? s.integ_ns - dt : 0;
+        s.integ_at_ns = t_ns;
+    }
+
+    // When the debounced state would follow the raw state if nothing changes
+    void schedule(KeyState& s, uint64_t t_ns, uint64_t T) const {
+        s.deadline_ns = kNever;
+        if (s.raw_down == s.stable_down) return;
+        if (spec_.kind == kDebounceDeferred) s.deadline_ns = t_ns + T;
+        else s.deadline_ns = t_ns + (s.raw_down ? T - s.integ_ns : s.integ_ns);
+    }
+
+    template <class Fn>
+    void resolve(KeyState& s, uint64_t now_ns, uint64_t T, Fn& fn) {
+        if (s.deadline_ns > now_ns) return;
+        const uint64_t at = s.deadline_ns;
+        s.deadline_ns = kNever;
+        if (spec_.kind == kDebounceIntegrator) {
+            s.integ_ns = s.raw_down ? T : 0;
+            s.integ_at_ns = at;
+        }
+        s.stable_down = s.raw_down;
+        if (s.stable_down && s.has_onset) {
+            s.has_onset = false;
+            fn(s.onset, s.onset_ns, at);
+        }
+    }
+
+    DeviceKeys& slot(uint64_t device) {
+        if (last_ && last_->device == device) return *last_;
+        for (auto& d : devices_) {
+            if (d->device == device) return *(last_ = d.get());
+        }
+        // New device: the only allocation, once per device
+        devices_.emplace_back(new DeviceKeys());
+        last_ = devices_.back().get();
+        last_->device = device;
+        return *last_;
+    }
+
+    DebounceSpec spec_;
+    std::vector<uint64_t> threshold_;
+    std::vector<std::unique_ptr<DeviceKeys>> devices_;
+    DeviceKeys* last_ = nullptr;
+    std::vector<PendingKey> pending_;
+};
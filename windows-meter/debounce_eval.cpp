@@ -0,0 +1,395 @@
+// debounce_eval.cpp
+// Replays a keyboard_*_raw.csv from key_logger through debounce strategies
+// (debounce.h) without recapturing. The raw log is parsed once; the
+// strategies are then evaluated in parallel, one thread per strategy at a
+// time, each over the whole edge stream. Edge times are the kernel stamp
+// when the row has one, else the host stamp, as in key_logger.
+//
+// One CSV row per strategy goes to stdout:
+//   spec            strategy (debounce.h spec text)
+//   presses         accepted presses
+//   rejected_downs  raw presses (DOWN after UP) that were not accepted
+//   delay_*_ms      decision time minus press onset (0 for eager)
+//   fast_repeats    accepted presses of a key less than --repeat-ms after its
+//                   previous one, a hint of chatter that got through
+// --keys FILE breaks the same down per device and key. Keys are named here,
+// from the HID usage (Usage column, or the scan code in older logs that had
+// a localized KeyName column instead), so logs of different hosts compare.
+//
+// Build (MSVC):  cl /std:c++17 /O2 /EHsc debounce_eval.cpp
+// Build (Linux): g++ -std=c++17 -O2 -Wall -pthread debounce_eval.cpp -o debounce_eval
+// Run: debounce_eval RAW.csv [SPEC ...] [options]   (see --help)
+//   Without SPECs every strategy is tried at 1..30 ms.
+
+#include "debounce.h"
+#include "key_codes.h"
+#include "key_core.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct RawEdge {
+    uint64_t device;
+    uint64_t t_ns;
+    uint32_t key;       // event_key_index()
+    uint32_t slot;      // dense (device, key) number
+    uint32_t line;      // index into RawLog::lines
+    bool down;
+};
+
+struct RawKey {
+    uint64_t device;
+    uint32_t key;       // event_key_index()
+    uint8_t usage;      // 0: none
+    uint64_t raw_presses = 0;
+};
+
+struct RawLog {
+    std::string text;
+    std::vector<std::string_view> lines;    // data rows, header excluded
+    std::string_view header;
+    std::vector<std::string_view> comments;  // "# session" / "# device" lines
+    std::vector<RawEdge> edges;
+    std::vector<RawKey> keys;               // by slot
+    uint32_t slots = 0;
+    uint64_t raw_presses = 0;
+};
+
+// Splits one CSV row; the KeyName field of older logs is quoted and may
+// hold commas
+static size_t split_row(std::string_view line, std::string_view* fields, size_t max) {
+    size_t n = 0, i = 0;
+    while (n < max) {
+        size_t start = i;
+        if (i < line.size() && line[i] == '"') {
+            const size_t close = line.find('"', i + 1);
+            if (close == std::string_view::npos) return n;
+            fields[n++] = line.substr(i + 1, close - i - 1);
+            i = close + 1;
+        } else {
+            while (i < line.size() && line[i] != ',') i++;
+            fields[n++] = line.substr(start, i - start);
+        }
+        if (i >= line.size()) break;
+        i++;    // ','
+    }
+    return n;
+}
+
+static bool parse_u64(std::string_view s, uint64_t& v) {
+    if (s.empty()) return false;
+    v = 0;
+    for (char c : s) {
+        if (c < '0' || c > '9') return false;
+        v = v * 10 + (uint64_t)(c - '0');
+    }
+    return true;
+}
+
+// devices: Device column values to keep, all if empty
+static bool load_raw_log(const char* path, const std::vector<uint64_t>& devices, RawLog& log) {
+    std::FILE* f = std::fopen(path, "rb");
+    if (!f) return false;
+    char buf[1 << 16];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) log.text.append(buf, n);
+    std::fclose(f);
+
+    std::unordered_map<uint64_t, uint32_t> slot_of;     // (device, key) -> slot
+    std::unordered_map<uint64_t, uint64_t> device_ids;  // handle -> small number
+    std::vector<bool> slot_down;
+
+    std::string_view all(log.text);
+    size_t pos = 0;
+    bool first = true;
+    bool usage_column = false;  // field 7: Usage, or the KeyName of older logs
+    while (pos < all.size()) {
+        size_t nl = all.find('\n', pos);
+        if (nl == std::string_view::npos) nl = all.size();
+        std::string_view line = all.substr(pos, nl - pos);
+        pos = nl + 1;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (line.empty()) continue;
+        if (first) {
+            first = false;
+            if (line.rfind("Device,", 0) == 0) {
+                log.header = line;
+                usage_column = key_csv_has_usage(line);
+                continue;
+            }
+        }
+        if (line[0] == '#') {
+            log.comments.push_back(line);
+            continue;
+        }
+
+        // Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,Usage,KernelTimestamp_ns
+        std::string_view fld[9];
+        uint64_t device, vkey, scan, e0, e1, host_ns, kernel_ns, usage;
+        if (split_row(line, fld, 9) < 8 || !parse_u64(fld[0], device) || !parse_u64(fld[1], vkey) ||
+            !parse_u64(fld[2], scan) || !parse_u64(fld[3], e0) || !parse_u64(fld[4], e1) ||
+            !parse_u64(fld[6], host_ns)) {
+            continue;
+        }
+        if (!devices.empty() && std::find(devices.begin(), devices.end(), device) == devices.end()) continue;
+
+        RawEdge e;
+        e.device = device;
+        e.down = fld[5] == "DOWN";
+        e.t_ns = parse_u64(fld[8], kernel_ns) ? kernel_ns : host_ns;
+        e.key = event_key_index((uint16_t)scan, (int)e0, (int)e1, (uint32_t)vkey);
+        const uint64_t dev_id = device_ids.emplace(device, device_ids.size()).first->second;
+        auto it = slot_of.emplace(dev_id * kKeyIndexCount + e.key, log.slots);
+        if (it.second) {
+            log.slots++;
+            slot_down.push_back(false);
+            if (!usage_column || !parse_u64(fld[7], usage) || usage > 0xFF) {
+                usage = scan_to_hid_usage((uint16_t)scan, (int)e0, (int)e1);
+            }
+            log.keys.push_back(RawKey{ device, e.key, (uint8_t)usage });
+        }
+        e.slot = it.first->second;
+        e.line = (uint32_t)log.lines.size();
+        if (e.down && !slot_down[e.slot]) {
+            log.raw_presses++;
+            log.keys[e.slot].raw_presses++;
+        }
+        slot_down[e.slot] = e.down;
+
+        log.lines.push_back(line);
+        log.edges.push_back(e);
+    }
+    return true;
+}
+
+struct EvalResult {
+    uint64_t presses = 0;
+    uint64_t fast_repeats = 0;
+    std::vector<uint64_t> delays_ns;
+    std::vector<uint32_t> accepted;     // line numbers, if kept
+    std::vector<uint64_t> key_presses;  // by slot
+    std::vector<uint64_t> key_fast_repeats;
+};
+
+static void evaluate(const RawLog& log, const DebounceSpec& spec, uint64_t repeat_ns,
+                     bool keep_lines, EvalResult& r) {
+    Debouncer<uint32_t> deb(spec);
+    std::vector<uint64_t> last_onset(log.slots, 0);
+    std::vector<bool> seen(log.slots, false);
+    r.key_presses.assign(log.slots, 0);
+    r.key_fast_repeats.assign(log.slots, 0);
+
+    auto on_accept = [&](uint32_t edge, uint64_t onset_ns, uint64_t decided_ns) {
+        const RawEdge& e = log.edges[edge];
+        r.presses++;
+        r.key_presses[e.slot]++;
+        r.delays_ns.push_back(decided_ns - onset_ns);
+        if (seen[e.slot] && onset_ns - last_onset[e.slot] < repeat_ns) {
+            r.fast_repeats++;
+            r.key_fast_repeats[e.slot]++;
+        }
+        seen[e.slot] = true;
+        last_onset[e.slot] = onset_ns;
+        if (keep_lines) r.accepted.push_back(e.line);
+    };
+
+    for (uint32_t i = 0; i < (uint32_t)log.edges.size(); i++) {
+        const RawEdge& e = log.edges[i];
+        deb.tick(e.t_ns, on_accept);
+        deb.edge(e.device, e.key, e.down, e.t_ns, i, on_accept);
+    }
+    deb.finish(on_accept);
+}
+
+// Report name of a key: by usage, else by scan code, else "SC_<make>[_E0][_E1]"
+// or, without a scan code, "NATIVE_<VKey>"
+static std::string key_report_name(const RawKey& k) {
+    const char* name = k.usage ? hid_usage_name(k.usage) : nullptr;
+    if (name) return name;
+    char buf[32];
+    if (k.key >= kScanKeyCount) {
+        std::snprintf(buf, sizeof(buf), "NATIVE_%u", (unsigned)(k.key - kScanKeyCount));
+        return buf;
+    }
+    const uint16_t make = k.key & 0xFF;
+    const int e0 = (k.key >> 8) & 1, e1 = (k.key >> 9) & 1;
+    name = scan_key_name(make, e0, e1);
+    if (name) return name;
+    std::snprintf(buf, sizeof(buf), "SC_%u%s%s", (unsigned)make, e0 ? "_E0" : "", e1 ? "_E1" : "");
+    return buf;
+}
+
+// spec,device,usage,key,raw_presses,presses,fast_repeats, keys in log order
+static bool write_key_report(const char* path, const RawLog& log, const std::vector<DebounceSpec>& specs,
+                             const std::vector<EvalResult>& results) {
+    std::FILE* out = std::fopen(path, "w");
+    if (!out) return false;
+    std::fprintf(out, "spec,device,usage,key,raw_presses,presses,fast_repeats\n");
+    for (size_t i = 0; i < specs.size(); i++) {
+        const std::string spec = format_debounce_spec(specs[i]);
+        for (uint32_t slot = 0; slot < log.slots; slot++) {
+            const RawKey& k = log.keys[slot];
+            std::fprintf(out, "\"%s\",%llu,%u,\"%s\",%llu,%llu,%llu\n", spec.c_str(),
+                         (unsigned long long)k.device, (unsigned)k.usage, key_report_name(k).c_str(),
+                         (unsigned long long)k.raw_presses,
+                         (unsigned long long)results[i].key_presses[slot],
+                         (unsigned long long)results[i].key_fast_repeats[slot]);
+        }
+    }
+    std::fclose(out);
+    return true;
+}
+
+static void print_usage(const char* argv0) {
+    std::fprintf(stderr,
+        "Usage: %s RAW.csv [SPEC ...] [options]\n"
+        "  SPEC                   <eager|deferred|integrator>:<ms>[,<key>=<ms>...]\n"
+        "                         (default: every strategy at 1..30 ms)\n"
+        "  -d, --device ID        only rows of this Device column value, repeatable\n"
+        "                         (see the \"# device\" lines of the log)\n"
+        "  -j, --threads N        worker threads (default: hardware threads)\n"
+        "  -k, --keys FILE        also write the results per device and key\n"
+        "  -r, --repeat-ms MS     fast repeat limit (default 50)\n"
+        "  -w, --write SPEC FILE  also write the filtered log SPEC would give\n"
+        "  -h, --help\n",
+        argv0);
+}
+
+int main(int argc, char** argv) {
+    const char* raw_path = nullptr;
+    std::vector<DebounceSpec> specs;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    double repeat_ms = 50.0;
+    DebounceSpec write_spec;
+    const char* write_path = nullptr;
+    std::vector<uint64_t> devices;
+    const char* keys_path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 2;
+        } else if ((arg == "-d" || arg == "--device") && i + 1 < argc) {
+            devices.push_back(std::strtoull(argv[++i], nullptr, 10));
+        } else if ((arg == "-j" || arg == "--threads") && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if ((arg == "-k" || arg == "--keys") && i + 1 < argc) {
+            keys_path = argv[++i];
+        } else if ((arg == "-r" || arg == "--repeat-ms") && i + 1 < argc) {
+            repeat_ms = std::atof(argv[++i]);
+        } else if ((arg == "-w" || arg == "--write") && i + 2 < argc) {
+            if (!parse_debounce_spec(argv[++i], write_spec)) {
+                std::fprintf(stderr, "Bad spec %s\n", argv[i]);
+                return 2;
+            }
+            write_path = argv[++i];
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::fprintf(stderr, "Unknown option or missing value: %s\n", arg.c_str());
+            print_usage(argv[0]);
+            return 2;
+        } else if (!raw_path) {
+            raw_path = argv[i];
+        } else {
+            DebounceSpec spec;
+            if (!parse_debounce_spec(arg, spec)) {
+                std::fprintf(stderr, "Bad spec %s\n", arg.c_str());
+                return 2;
+            }
+            specs.push_back(spec);
+        }
+    }
+    if (!raw_path) {
+        print_usage(argv[0]);
+        return 2;
+    }
+    if (specs.empty()) {
+        const double grid_ms[] = { 1, 2, 3, 5, 8, 10, 15, 20, 30 };
+        for (DebounceKind kind : { kDebounceEager, kDebounceDeferred, kDebounceIntegrator }) {
+            for (double ms : grid_ms) {
+                DebounceSpec spec;
+                spec.kind = kind;
+                spec.threshold_ns = (uint64_t)(ms * 1e6);
+                specs.push_back(spec);
+            }
+        }
+    }
+
+    RawLog log;
+    if (!load_raw_log(raw_path, devices, log)) {
+        std::fprintf(stderr, "Failed to read %s\n", raw_path);
+        return 1;
+    }
+    std::fprintf(stderr, "%s: %zu edges, %llu raw presses, %u keys; %zu strategies on %u threads\n",
+                 raw_path, log.edges.size(), (unsigned long long)log.raw_presses, log.slots,
+                 specs.size(), threads);
+
+    // One pass over the stream per strategy, strategies spread over threads
+    const uint64_t repeat_ns = (uint64_t)(repeat_ms * 1e6);
+    std::vector<EvalResult> results(specs.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i; (i = next.fetch_add(1)) < specs.size();) {
+            evaluate(log, specs[i], repeat_ns, false, results[i]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < std::min<size_t>(threads, specs.size()); t++) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    std::printf("spec,presses,rejected_downs,delay_mean_ms,delay_p99_ms,delay_max_ms,fast_repeats\n");
+    for (size_t i = 0; i < specs.size(); i++) {
+        EvalResult& r = results[i];
+        double mean_ms = 0, p99_ms = 0, max_ms = 0;
+        if (!r.delays_ns.empty()) {
+            std::sort(r.delays_ns.begin(), r.delays_ns.end());
+            uint64_t sum = 0;
+            for (uint64_t d : r.delays_ns) sum += d;
+            mean_ms = (double)sum / (double)r.delays_ns.size() * 1e-6;
+            p99_ms = (double)r.delays_ns[(r.delays_ns.size() - 1) * 99 / 100] * 1e-6;
+            max_ms = (double)r.delays_ns.back() * 1e-6;
+        }
+        const uint64_t rejected = log.raw_presses > r.presses ? log.raw_presses - r.presses : 0;
+        std::printf("\"%s\",%llu,%llu,%.3f,%.3f,%.3f,%llu\n",
+                    format_debounce_spec(specs[i]).c_str(), (unsigned long long)r.presses,
+                    (unsigned long long)rejected, mean_ms, p99_ms, max_ms,
+                    (unsigned long long)r.fast_repeats);
+    }
+
+    if (keys_path) {
+        if (!write_key_report(keys_path, log, specs, results)) {
+            std::fprintf(stderr, "Failed to create %s\n", keys_path);
+            return 1;
+        }
+        std::fprintf(stderr, "%s: %u keys x %zu strategies\n", keys_path, log.slots, specs.size());
+    }
+
+    if (write_path) {
+        EvalResult r;
+        evaluate(log, write_spec, repeat_ns, true, r);
+        std::FILE* out = std::fopen(write_path, "w");
+        if (!out) {
+            std::fprintf(stderr, "Failed to create %s\n", write_path);
+            return 1;
+        }
+        if (!log.header.empty()) std::fprintf(out, "%.*s\n", (int)log.header.size(), log.header.data());
+        for (std::string_view c : log.comments) std::fprintf(out, "%.*s\n", (int)c.size(), c.data());
+        for (uint32_t line : r.accepted) {
+            std::fprintf(out, "%.*s\n", (int)log.lines[line].size(), log.lines[line].data());
+        }
+        std::fclose(out);
+        std::fprintf(stderr, "%s: %llu presses (%s)\n", write_path, (unsigned long long)r.presses,
+                     format_debounce_spec(write_spec).c_str());
+    }
+    return 0;
+}
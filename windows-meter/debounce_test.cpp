@@ -0,0 +1,276 @@
+// debounce_test.cpp
+// Checks the debounce strategies (debounce.h) on hand-made edge sequences:
+// the spec text, bounce rejection and accept times of eager, deferred and
+// integrator, per-key thresholds, devices kept apart, presses settled by
+// tick() and finish(), and edges that arrive after a decision was taken.
+// Payloads are sequence numbers, as debounce_eval uses row numbers.
+//
+// Build (MSVC):  cl /std:c++17 /O2 /EHsc debounce_test.cpp
+// Build (Linux): g++ -std=c++17 -O2 -Wall debounce_test.cpp -o debounce_test
+// Run: debounce_test   (exit code 0 when every check passes)
+
+#include "debounce.h"
+#include "test_check.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static constexpr uint64_t kMs = 1000000;
+
+struct Accept {
+    int onset;
+    uint64_t onset_ns;
+    uint64_t decided_ns;
+    bool operator==(const Accept& o) const {
+        return onset == o.onset && onset_ns == o.onset_ns && decided_ns == o.decided_ns;
+    }
+};
+typedef std::vector<Accept> Accepts;
+
+static std::string format(const Accepts& a) {
+    std::string s;
+    char buf[64];
+    for (const Accept& x : a) {
+        std::snprintf(buf, sizeof(buf), " #%d@%.3f->%.3f", x.onset, (double)x.onset_ns / kMs,
+                      (double)x.decided_ns / kMs);
+        s += buf;
+    }
+    return s.empty() ? " (none)" : s;
+}
+
+#define CHECK_ACCEPTS(got, ...)                                                    \
+    do {                                                                           \
+        const Accepts want_ = __VA_ARGS__;                                         \
+        CHECK((got) == want_, "got%s, want%s", format(got).c_str(), format(want_).c_str()); \
+    } while (0)
+
+// Feeds edges to one Debouncer and collects what it accepts
+class Run {
+public:
+    explicit Run(const char* spec) {
+        DebounceSpec s;
+        CHECK(parse_debounce_spec(spec, s), "spec \"%s\" rejected", spec);
+        d_ = Debouncer<int>(s);
+    }
+
+    // Edge number n (its payload) of key on device
+    Run& edge(int n, uint32_t key, bool down, uint64_t t_ns, uint64_t device = 1) {
+        d_.edge(device, key, down, t_ns, n, collect());
+        return *this;
+    }
+    Run& down(int n, uint64_t t_ns, uint32_t key = 0x1E) { return edge(n, key, true, t_ns); }
+    Run& up(int n, uint64_t t_ns, uint32_t key = 0x1E) { return edge(n, key, false, t_ns); }
+    Run& tick(uint64_t now_ns) { d_.tick(now_ns, collect()); return *this; }
+    Run& finish() { d_.finish(collect()); return *this; }
+
+    // Accepted since the last call
+    Accepts take() {
+        Accepts a;
+        a.swap(accepts_);
+        return a;
+    }
+
+private:
+    struct Collect {
+        Accepts* out;
+        void operator()(const int& onset, uint64_t onset_ns, uint64_t decided_ns) const {
+            out->push_back(Accept{ onset, onset_ns, decided_ns });
+        }
+    };
+    Collect collect() { return Collect{ &accepts_ }; }
+
+    Debouncer<int> d_;
+    Accepts accepts_;
+};
+
+static void test_spec() {
+    DebounceSpec s;
+    CHECK(parse_debounce_spec("eager:5", s) && s.kind == kDebounceEager && s.threshold_ns == 5 * kMs &&
+          s.per_key.empty(), "eager:5");
+    CHECK(parse_debounce_spec("integrator:2.5", s) && s.kind == kDebounceIntegrator &&
+          s.threshold_ns == 2500000, "integrator:2.5");
+    CHECK(parse_debounce_spec("deferred:8,0x39=12,30=0", s) && s.kind == kDebounceDeferred &&
+          s.threshold_ns == 8 * kMs && s.per_key.size() == 2 && s.per_key[0].first == 0x39 &&
+          s.per_key[0].second == 12 * kMs && s.per_key[1].first == 30 && s.per_key[1].second == 0,
+          "deferred with per-key thresholds");
+    CHECK(parse_debounce_spec("eager:5,0x7FF=1", s) && s.per_key[0].first == kKeyIndexCount - 1,
+          "last native key");
+
+    const char* const bad[] = { "", "eager", "eager:", "fast:5", "Eager:5", "eager:x", "eager:5ms",
+                                "eager:-1", "eager:10001", "eager:5,", "eager:5,0x39", "eager:5,0x39=",
+                                "eager:5,=3", "eager:5,0x800=3", "eager:5,0x39=3x" };
+    for (const char* text : bad) {
+        DebounceSpec out;
+        out.threshold_ns = 42;
+        CHECK(!parse_debounce_spec(text, out), "\"%s\" accepted", text);
+        CHECK(out.threshold_ns == 42 && out.kind == kDebounceEager, "\"%s\" wrote the spec", text);
+    }
+
+    const char* const round_trip[] = { "eager:5", "integrator:2.5", "deferred:8,0x39=12,0x41e=0.25" };
+    for (const char* text : round_trip) {
+        DebounceSpec spec;
+        parse_debounce_spec(text, spec);
+        const std::string back = format_debounce_spec(spec);
+        CHECK(back == text, "\"%s\" formats as \"%s\"", text, back.c_str());
+    }
+}
+
+// Eager takes a DOWN at once and ignores DOWNs for threshold after it
+static void test_eager() {
+    Run r("eager:5");
+    r.down(0, 0);
+    CHECK_ACCEPTS(r.take(), { { 0, 0, 0 } });
+    r.up(1, 1 * kMs).down(2, 2 * kMs).up(3, 3 * kMs);
+    CHECK_ACCEPTS(r.take(), {});
+    // Exactly threshold after the last accept is a new press
+    r.down(4, 5 * kMs);
+    CHECK_ACCEPTS(r.take(), { { 4, 5 * kMs, 5 * kMs } });
+    // Autorepeat while down
+    r.down(5, 20 * kMs).down(6, 40 * kMs);
+    CHECK_ACCEPTS(r.take(), {});
+    r.up(7, 41 * kMs).tick(100 * kMs).finish();
+    CHECK_ACCEPTS(r.take(), {});
+    r.down(8, 50 * kMs);
+    CHECK_ACCEPTS(r.take(), { { 8, 50 * kMs, 50 * kMs } });
+}
+
+// Deferred waits until the key has been down for threshold without an edge;
+// the press is reported by its first DOWN
+static void test_deferred() {
+    Run r("deferred:5");
+    r.down(0, 0).up(1, 1 * kMs).down(2, 2 * kMs);
+    CHECK_ACCEPTS(r.take(), {});
+    r.tick(7 * kMs - 1);
+    CHECK_ACCEPTS(r.take(), {});
+    r.tick(7 * kMs);
+    CHECK_ACCEPTS(r.take(), { { 0, 0, 7 * kMs } });
+    r.tick(100 * kMs);
+    CHECK_ACCEPTS(r.take(), {});
+
+    // A bounce on release is not a new press
+    r.up(3, 110 * kMs).down(4, 112 * kMs).finish();
+    CHECK_ACCEPTS(r.take(), {});
+
+    // A press decided by the key's own next edge, at its deadline
+    r.up(5, 120 * kMs).down(6, 130 * kMs).up(7, 140 * kMs);
+    CHECK_ACCEPTS(r.take(), { { 6, 130 * kMs, 135 * kMs } });
+
+    // Down shorter than threshold: never accepted
+    r.down(8, 200 * kMs).up(9, 204 * kMs).finish();
+    CHECK_ACCEPTS(r.take(), {});
+
+    // DOWN within threshold of the last UP continues the press that ended
+    // there; a full threshold after it, a new press starts
+    r.down(10, 300 * kMs).up(11, 301 * kMs).down(12, 305 * kMs).finish();
+    CHECK_ACCEPTS(r.take(), { { 10, 300 * kMs, 310 * kMs } });
+    r.up(13, 320 * kMs).down(14, 400 * kMs).up(15, 401 * kMs).down(16, 406 * kMs).finish();
+    CHECK_ACCEPTS(r.take(), { { 16, 406 * kMs, 411 * kMs } });
+}
+
+// The integrator rises while down and falls while up: chatter delays the
+// accept by the time spent up, not by a full threshold
+static void test_integrator() {
+    Run r("integrator:4");
+    r.down(0, 0).up(1, 3 * kMs).down(2, 4 * kMs);
+    CHECK_ACCEPTS(r.take(), {});
+    r.tick(6 * kMs - 1);
+    CHECK_ACCEPTS(r.take(), {});
+    r.tick(6 * kMs);
+    CHECK_ACCEPTS(r.take(), { { 0, 0, 6 * kMs } });
+
+    // An UP shorter than threshold does not release the key
+    r.up(3, 10 * kMs).down(4, 12 * kMs).tick(50 * kMs);
+    CHECK_ACCEPTS(r.take(), {});
+    // Up at 20 with the level back at 4; a flicker down at 23 leaves it at
+    // 1 ms, so the key is released just after 24
+    r.up(5, 20 * kMs).down(6, 23 * kMs).up(7, 23 * kMs + 1);
+    r.tick(25 * kMs);
+    CHECK_ACCEPTS(r.take(), {});
+    // The next DOWN is a new press even within threshold of that UP
+    r.down(8, 26 * kMs).finish();
+    CHECK_ACCEPTS(r.take(), { { 8, 26 * kMs, 30 * kMs } });
+
+    // The same chatter under deferred waits the full threshold after the last DOWN
+    Run d("deferred:4");
+    d.down(0, 0).up(1, 3 * kMs).down(2, 4 * kMs).finish();
+    CHECK_ACCEPTS(d.take(), { { 0, 0, 8 * kMs } });
+}
+
+// An edge can arrive stamped before the integrator's last update: tick()
+// decided the key meanwhile (key_logger ticks behind the clock), or the
+// key's stamps come from two clocks (kernel and host). Such an edge
+// integrates no time and cannot turn into a second press.
+static void test_late_edge() {
+    Run r("integrator:4");
+    r.down(0, 0).tick(10 * kMs);
+    CHECK_ACCEPTS(r.take(), { { 0, 0, 4 * kMs } });
+    // Bounce stamped 3 ms and 3.5 ms, delivered after the decision at 4 ms
+    r.up(1, 3 * kMs).down(2, 3 * kMs + kMs / 2).finish();
+    CHECK_ACCEPTS(r.take(), {});
+    // Late UP: released a full threshold after it, then a new press
+    r.up(3, 5 * kMs).down(4, 8 * kMs).tick(20 * kMs);
+    CHECK_ACCEPTS(r.take(), {});
+    r.up(5, 30 * kMs).tick(40 * kMs).up(6, 33 * kMs).down(7, 50 * kMs).finish();
+    CHECK_ACCEPTS(r.take(), { { 7, 50 * kMs, 54 * kMs } });
+
+    // Level 2 at the UP at 2; the DOWN stamped 1 keeps it and needs 2 more
+    Run o("integrator:4");
+    o.down(0, 0).up(1, 2 * kMs).down(2, 1 * kMs).finish();
+    const Accepts a = o.take();
+    CHECK(a.size() == 1 && a[0].decided_ns == 3 * kMs, "out-of-order DOWN: got%s, want one decided at 3",
+          format(a).c_str());
+}
+
+static void test_per_key() {
+    Run r("eager:5,0x39=12");
+    r.down(0, 0, 0x39).up(1, 1 * kMs, 0x39).down(2, 0, 0x1E).up(3, 1 * kMs, 0x1E);
+    CHECK_ACCEPTS(r.take(), { { 0, 0, 0 }, { 2, 0, 0 } });
+    r.down(4, 8 * kMs, 0x39).down(5, 8 * kMs, 0x1E);
+    CHECK_ACCEPTS(r.take(), { { 5, 8 * kMs, 8 * kMs } });
+    r.up(6, 9 * kMs, 0x39).down(7, 12 * kMs, 0x39);
+    CHECK_ACCEPTS(r.take(), { { 7, 12 * kMs, 12 * kMs } });
+
+    // A per-key threshold of 0 takes every press
+    Run z("deferred:5,0x1E=0");
+    z.down(0, 0).up(1, 1 * kMs).down(2, 2 * kMs);
+    CHECK_ACCEPTS(z.take(), { { 0, 0, 0 }, { 2, 2 * kMs, 2 * kMs } });
+}
+
+// The same key on two devices is two keys
+static void test_devices() {
+    Run r("deferred:5");
+    r.edge(0, 0x1E, true, 0, 1).edge(1, 0x1E, true, 2 * kMs, 2).edge(2, 0x1E, false, 3 * kMs, 1);
+    r.tick(10 * kMs);
+    CHECK_ACCEPTS(r.take(), { { 1, 2 * kMs, 7 * kMs } });
+
+    Run e("eager:5");
+    e.edge(0, 0x1E, true, 0, 1).edge(1, 0x1E, true, 1 * kMs, 2);
+    CHECK_ACCEPTS(e.take(), { { 0, 0, 0 }, { 1, 1 * kMs, 1 * kMs } });
+}
+
+// tick() settles only the keys that are due and keeps the others pending
+static void test_tick_pending() {
+    Run r("deferred:5,0x10=1,0x11=3");
+    r.down(0, 0, 0x10).down(1, 0, 0x11).down(2, 0, 0x12);
+    r.tick(3 * kMs);
+    CHECK_ACCEPTS(r.take(), { { 0, 0, 1 * kMs }, { 1, 0, 3 * kMs } });
+    r.tick(4 * kMs);
+    CHECK_ACCEPTS(r.take(), {});
+    r.finish();
+    CHECK_ACCEPTS(r.take(), { { 2, 0, 5 * kMs } });
+    r.finish();
+    CHECK_ACCEPTS(r.take(), {});
+}
+
+int main() {
+    test_spec();
+    test_eager();
+    test_deferred();
+    test_integrator();
+    test_late_edge();
+    test_per_key();
+    test_devices();
+    test_tick_pending();
+    return test_result("debounce_test");
+}
@@ -0,0 +1,208 @@
+// hid_keyboard.h
+// Turns raw HID input reports of a keyboard into key down/up edges, without
+// the OS input layer. The report descriptor is parsed once for the keyboard
+// fields (usage page 0x07) of every input report:
+//  - array fields:    boot protocol and 6KRO reports, each element holds the
+//                     usage of one pressed key
+//  - 1-bit variables: modifier byte and NKRO bitmaps, one bit per usage
+// Without a descriptor the boot protocol layout is assumed (8 modifier bits,
+// a reserved byte, 6 key slots). Key state is kept as a 256-bit set per
+// decoder; each report is diffed against it. Platform independent, no
+// allocation per report; hid_keyboard_test.cpp exercises it without a device.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+struct HidKeyField {
+    uint8_t report_id;      // 0: reports carry no ID byte
+    uint32_t bit_offset;    // after the ID byte
+    uint8_t bit_size;
+    uint16_t count;
+    uint16_t usage_min;
+    int32_t logical_min;
+    bool array;
+};
+
+class HidKeyboard {
+public:
+    static constexpr uint16_t kUsagePageKeyboard = 0x07;
+
+    HidKeyboard() { set_boot_layout(); }
+
+    void set_boot_layout() {
+        fields_.clear();
+        uses_ids_ = false;
+        fields_.push_back(HidKeyField{ 0, 0, 1, 8, 0xE0, 0, false });
+        fields_.push_back(HidKeyField{ 0, 16, 8, 6, 0, 0, true });
+        reset();
+    }
+
+    // False if the descriptor has no keyboard input fields (layout unchanged)
+    bool parse_descriptor(const uint8_t* d, size_t len);
+
+    bool uses_report_ids() const { return uses_ids_; }
+    void reset() { std::memset(down_, 0, sizeof(down_)); }
+
+    // Calls fn(usage, down) for every key that changed. Reports with an
+    // error code (rollover, phantom state) carry no key state and are skipped.
+    // Returns false if the report has no keyboard fields.
+    template <class Fn>
+    bool decode(const uint8_t* report, size_t len, Fn&& fn) {
+        uint8_t id = 0;
+        if (uses_ids_) {
+            if (len == 0) return false;
+            id = report[0];
+            report++;
+            len--;
+        }
+
+        uint64_t now[4] = {};
+        bool any_field = false;
+        for (const HidKeyField& f : fields_) {
+            if (f.report_id != id) continue;
+            any_field = true;
+            for (uint16_t i = 0; i < f.count; i++) {
+                const uint32_t bit = f.bit_offset + (uint32_t)i * f.bit_size;
+                if ((bit + f.bit_size + 7) / 8 > len) break;   // short report
+                const uint32_t v = extract(report, bit, f.bit_size);
+                if (f.array) {
+                    const int32_t idx = (int32_t)v - f.logical_min;
+                    if (idx < 0) continue;
+                    const uint32_t usage = f.usage_min + (uint32_t)idx;
+                    if (usage == 0 || usage > 0xFF) continue;
+                    if (usage <= 0x03) return true;   // ErrorRollOver/POSTFail/ErrorUndefined
+                    now[usage >> 6] |= 1ULL << (usage & 63);
+                } else if (v) {
+                    const uint32_t usage = f.usage_min + i;
+                    if (usage <= 0xFF) now[usage >> 6] |= 1ULL << (usage & 63);
+                }
+            }
+        }
+        if (!any_field) return false;
+
+        for (int w = 0; w < 4; w++) {
+            uint64_t changed = now[w] ^ down_[w];
+            while (changed) {
+                const int b = ctz64(changed);
+                changed &= changed - 1;
+                fn((uint8_t)(w * 64 + b), (now[w] >> b) & 1);
+            }
+            down_[w] = now[w];
+        }
+        return true;
+    }
+
+private:
+    static uint32_t extract(const uint8_t* p, uint32_t bit, uint8_t size) {
+        uint32_t v = 0;
+        for (uint8_t i = 0; i < size; i++) {
+            const uint32_t b = bit + i;
+            v |= (uint32_t)((p[b >> 3] >> (b & 7)) & 1) << i;
+        }
+        return v;
+    }
+
+    static int ctz64(uint64_t x) {
+        int n = 0;
+        while (!(x & 1)) { x >>= 1; n++; }
+        return n;
+    }
+
+    std::vector<HidKeyField> fields_;
+    bool uses_ids_ = false;
+    uint64_t down_[4];
+};
+
+// Short items only; long items are skipped. Tracks the input bit offset per
+// report ID and keeps the fields on the keyboard usage page.
+inline bool HidKeyboard::parse_descriptor(const uint8_t* d, size_t len) {
+    struct Globals {
+        uint16_t usage_page = 0;
+        int32_t logical_min = 0;
+        uint32_t report_size = 0;
+        uint32_t report_count = 0;
+        uint8_t report_id = 0;
+    };
+    Globals g;
+    Globals stack[4];
+    int depth = 0;
+    uint32_t usage_min = 0;
+    bool have_range = false;
+    std::vector<uint32_t> usages;
+    uint32_t offsets[256] = {};
+    std::vector<HidKeyField> fields;
+    bool uses_ids = false;
+
+    size_t i = 0;
+    while (i < len) {
+        const uint8_t prefix = d[i++];
+        if (prefix == 0xFE) {                       // long item
+            if (i + 1 >= len) break;
+            i += 2 + d[i];
+            continue;
+        }
+        const size_t size = (prefix & 3) == 3 ? 4 : (prefix & 3);
+        if (i + size > len) break;
+        uint32_t u = 0;
+        for (size_t k = 0; k < size; k++) u |= (uint32_t)d[i + k] << (8 * k);
+        int32_t s = (int32_t)u;
+        if (size == 1) s = (int8_t)u;
+        else if (size == 2) s = (int16_t)u;
+        i += size;
+
+        const uint8_t type = (prefix >> 2) & 3;
+        const uint8_t tag = prefix >> 4;
+        if (type == 1) {                            // global
+            switch (tag) {
+            case 0:  g.usage_page = (uint16_t)u; break;
+            case 1:  g.logical_min = s; break;
+            case 7:  g.report_size = u; break;
+            case 8:  g.report_id = (uint8_t)u; uses_ids = true; break;
+            case 9:  g.report_count = u; break;
+            case 10: if (depth < 4) stack[depth++] = g; break;
+            case 11: if (depth > 0) g = stack[--depth]; break;
+            }
+        } else if (type == 2) {                     // local
+            // 4-byte usages carry their own page in the high half
+            const bool own_page = size == 4;
+            if (own_page && (u >> 16) != kUsagePageKeyboard) continue;
+            const uint32_t usage = u & 0xFFFF;
+            // Variable fields are taken as consecutive usages from the first
+            if (tag == 0) usages.push_back(usage);
+            else if (tag == 1) { usage_min = usage; have_range = true; }
+        } else if (type == 0) {                     // main
+            if (tag == 8) {                         // Input
+                const bool constant = u & 1;
+                const bool variable = (u >> 1) & 1;
+                const uint32_t bits = g.report_size * g.report_count;
+                if (!constant && g.usage_page == kUsagePageKeyboard && g.report_size > 0 &&
+                    g.report_size <= 16 && g.report_count <= 1024) {
+                    HidKeyField f;
+                    f.report_id = g.report_id;
+                    f.bit_offset = offsets[g.report_id];
+                    f.bit_size = (uint8_t)g.report_size;
+                    f.count = (uint16_t)g.report_count;
+                    f.usage_min = (uint16_t)(have_range ? usage_min : (usages.empty() ? 0 : usages[0]));
+                    f.logical_min = g.logical_min;
+                    f.array = !variable;
+                    if (f.array || f.bit_size == 1) fields.push_back(f);
+                }
+                offsets[g.report_id] += bits;
+            }
+            // Locals are reset by every main item
+            usages.clear();
+            have_range = false;
+            usage_min = 0;
+        }
+    }
+
+    if (fields.empty()) return false;
+    fields_ = fields;
+    uses_ids_ = uses_ids;
+    reset();
+    return true;
+}
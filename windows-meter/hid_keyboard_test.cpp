@@ -0,0 +1,172 @@
+// hid_keyboard_test.cpp
+// Checks the HID keyboard report decoder (hid_keyboard.h) without a device:
+// the boot layout assumed without a descriptor, the standard boot keyboard
+// descriptor, a composite device whose keyboard and consumer reports are
+// told apart by report ID, an NKRO bitmap, rollover error reports, short
+// reports and descriptors without keyboard fields.
+//
+// Build (MSVC):  cl /std:c++17 /O2 /EHsc hid_keyboard_test.cpp
+// Build (Linux): g++ -std=c++17 -O2 -Wall hid_keyboard_test.cpp -o hid_keyboard_test
+// Run: hid_keyboard_test   (exit code 0 when every check passes)
+
+#include "hid_keyboard.h"
+#include "test_check.h"
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef std::vector<std::pair<uint8_t, bool>> Edges;    // usage, down
+
+static Edges decode(HidKeyboard& kb, const std::vector<uint8_t>& report, bool* ok = nullptr) {
+    Edges edges;
+    const bool r = kb.decode(report.data(), report.size(),
+                             [&](uint8_t usage, bool down) { edges.emplace_back(usage, down); });
+    if (ok) *ok = r;
+    return edges;
+}
+
+static std::string format(const Edges& edges) {
+    std::string s;
+    char buf[16];
+    for (const auto& e : edges) {
+        std::snprintf(buf, sizeof(buf), " %02X%s", e.first, e.second ? "v" : "^");
+        s += buf;
+    }
+    return s.empty() ? " (none)" : s;
+}
+
+#define CHECK_EDGES(got, ...)                                                      \
+    do {                                                                           \
+        const Edges want_ = __VA_ARGS__;                                           \
+        CHECK((got) == want_, "got%s, want%s", format(got).c_str(), format(want_).c_str()); \
+    } while (0)
+
+// HID 1.11 appendix B.1: modifiers, reserved byte, LED output, 6 key array
+static const std::vector<uint8_t> kBootDescriptor = {
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00,
+    0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02, 0x95, 0x01, 0x75, 0x08, 0x81, 0x01,
+    0x95, 0x05, 0x75, 0x01, 0x05, 0x08, 0x19, 0x01, 0x29, 0x05, 0x91, 0x02, 0x95, 0x01,
+    0x75, 0x03, 0x91, 0x01, 0x95, 0x06, 0x75, 0x08, 0x15, 0x00, 0x25, 0x65, 0x05, 0x07,
+    0x19, 0x00, 0x29, 0x65, 0x81, 0x00, 0xC0,
+};
+
+// Composite gaming keyboard: report 1 is the boot layout, report 2 a 16-bit
+// consumer control array, report 3 an NKRO bitmap of usages 0x00..0x67 after
+// the modifier byte. Starts with a long item, which must be skipped: its
+// data would read as a keyboard array field without a report ID.
+static const std::vector<uint8_t> kCompositeDescriptor = {
+    0xFE, 0x08, 0x00, 0x75, 0x08, 0x95, 0x01, 0x05, 0x07, 0x81, 0x00,
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x85, 0x01, 0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7,
+    0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02, 0x95, 0x01, 0x75, 0x08,
+    0x81, 0x01, 0x95, 0x06, 0x75, 0x08, 0x15, 0x00, 0x25, 0x65, 0x19, 0x00, 0x29, 0x65,
+    0x81, 0x00, 0xC0,
+    0x05, 0x0C, 0x09, 0x01, 0xA1, 0x01, 0x85, 0x02, 0x15, 0x00, 0x26, 0xFF, 0x03, 0x19,
+    0x00, 0x2A, 0xFF, 0x03, 0x75, 0x10, 0x95, 0x01, 0x81, 0x00, 0xC0,
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x85, 0x03, 0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7,
+    0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02, 0x19, 0x00, 0x29, 0x67,
+    0x95, 0x68, 0x81, 0x02, 0xC0,
+};
+
+// Mouse: buttons and X/Y, nothing on the keyboard page
+static const std::vector<uint8_t> kMouseDescriptor = {
+    0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x09, 0x01, 0xA1, 0x00, 0x05, 0x09, 0x19, 0x01,
+    0x29, 0x03, 0x15, 0x00, 0x25, 0x01, 0x95, 0x03, 0x75, 0x01, 0x81, 0x02, 0x95, 0x01,
+    0x75, 0x05, 0x81, 0x01, 0x05, 0x01, 0x09, 0x30, 0x09, 0x31, 0x15, 0x81, 0x25, 0x7F,
+    0x75, 0x08, 0x95, 0x02, 0x81, 0x06, 0xC0, 0xC0,
+};
+
+// Boot reports: modifiers, reserved, 6 key slots
+static void test_boot_layout(HidKeyboard& kb) {
+    // Shift+A, then B added, then A released, then all up
+    CHECK_EDGES(decode(kb, { 0x02, 0, 0x04, 0, 0, 0, 0, 0 }), { { 0x04, true }, { 0xE1, true } });
+    CHECK_EDGES(decode(kb, { 0x02, 0, 0x04, 0x05, 0, 0, 0, 0 }), { { 0x05, true } });
+    CHECK_EDGES(decode(kb, { 0x02, 0, 0x05, 0, 0, 0, 0, 0 }), { { 0x04, false } });
+    CHECK_EDGES(decode(kb, { 0x02, 0, 0x05, 0, 0, 0, 0, 0 }), {});
+    CHECK_EDGES(decode(kb, { 0, 0, 0, 0, 0, 0, 0, 0 }), { { 0x05, false }, { 0xE1, false } });
+
+    // Six keys at once, then a rollover report (more keys than slots): no
+    // key state, so nothing changes until the next real report
+    CHECK_EDGES(decode(kb, { 0, 0, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09 }),
+                { { 0x04, true }, { 0x05, true }, { 0x06, true }, { 0x07, true }, { 0x08, true },
+                  { 0x09, true } });
+    bool ok = false;
+    CHECK_EDGES(decode(kb, { 0, 0, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01 }, &ok), {});
+    CHECK(ok, "a rollover report is a keyboard report");
+    CHECK_EDGES(decode(kb, { 0, 0, 0x04, 0x05, 0x06, 0x07, 0x08, 0 }), { { 0x09, false } });
+
+    // A short report only covers the slots it has
+    CHECK_EDGES(decode(kb, { 0, 0, 0x04, 0x05 }), { { 0x06, false }, { 0x07, false }, { 0x08, false } });
+    CHECK_EDGES(decode(kb, { 0, 0, 0, 0, 0, 0, 0, 0 }), { { 0x04, false }, { 0x05, false } });
+}
+
+static void test_no_descriptor() {
+    HidKeyboard kb;
+    CHECK(!kb.uses_report_ids(), "boot layout has no report IDs");
+    test_boot_layout(kb);
+}
+
+static void test_boot_descriptor() {
+    HidKeyboard kb;
+    CHECK(kb.parse_descriptor(kBootDescriptor.data(), kBootDescriptor.size()), "boot descriptor rejected");
+    CHECK(!kb.uses_report_ids(), "boot descriptor has no report IDs");
+    test_boot_layout(kb);
+}
+
+static void test_report_ids() {
+    HidKeyboard kb;
+    CHECK(kb.parse_descriptor(kCompositeDescriptor.data(), kCompositeDescriptor.size()),
+          "composite descriptor rejected");
+    CHECK(kb.uses_report_ids(), "composite descriptor uses report IDs");
+
+    bool ok = false;
+    CHECK_EDGES(decode(kb, { 1, 0x01, 0, 0x29, 0, 0, 0, 0, 0 }, &ok), { { 0x29, true }, { 0xE0, true } });
+    CHECK(ok, "report 1 is a keyboard report");
+
+    // Volume up (0xE9) on the consumer page must not become a key
+    CHECK_EDGES(decode(kb, { 2, 0xE9, 0x00 }, &ok), {});
+    CHECK(!ok, "report 2 has no keyboard fields");
+    CHECK_EDGES(decode(kb, {}, &ok), {});
+    CHECK(!ok, "empty report with report IDs");
+
+    // Every report is diffed against the one state: report 1 releases
+    CHECK_EDGES(decode(kb, { 1, 0, 0, 0, 0, 0, 0, 0, 0 }), { { 0x29, false }, { 0xE0, false } });
+
+    // NKRO bitmap, report 3: bit n of the 13 bytes after the modifiers is usage n
+    std::vector<uint8_t> nkro(1 + 1 + 13, 0);
+    nkro[0] = 3;
+    nkro[1] = 0x20;                                         // Right Shift
+    const uint8_t keys[] = { 0x04, 0x1E, 0x2C, 0x52, 0x67 }; // A, 1, Space, Up, F16
+    for (uint8_t u : keys) nkro[2 + u / 8] |= (uint8_t)(1 << (u % 8));
+    CHECK_EDGES(decode(kb, nkro, &ok), { { 0x04, true }, { 0x1E, true }, { 0x2C, true }, { 0x52, true },
+                                         { 0x67, true }, { 0xE5, true } });
+    CHECK(ok, "report 3 is a keyboard report");
+    nkro[2 + 0x2C / 8] &= (uint8_t)~(1 << (0x2C % 8));
+    CHECK_EDGES(decode(kb, nkro), { { 0x2C, false } });
+
+    // An unknown report ID is not a keyboard report and changes nothing
+    CHECK_EDGES(decode(kb, { 9, 0, 0, 0, 0, 0, 0, 0, 0 }, &ok), {});
+    CHECK(!ok, "report 9 is unknown");
+    // So is ID 0, which only the long item's data would have declared
+    CHECK_EDGES(decode(kb, { 0, 0x04 }, &ok), {});
+    CHECK(!ok, "report 0 is unknown");
+}
+
+static void test_non_keyboard() {
+    HidKeyboard kb;
+    CHECK(!kb.parse_descriptor(kMouseDescriptor.data(), kMouseDescriptor.size()), "mouse taken as a keyboard");
+    CHECK(!kb.parse_descriptor(nullptr, 0), "empty descriptor taken as a keyboard");
+    // Truncated in the middle of an item
+    CHECK(!kb.parse_descriptor(kBootDescriptor.data(), 21), "keyboard fields from a truncated descriptor");
+    // The layout is unchanged after a rejected descriptor
+    test_boot_layout(kb);
+}
+
+int main() {
+    test_no_descriptor();
+    test_boot_descriptor();
+    test_report_ids();
+    test_non_keyboard();
+    return test_result("hid_keyboard_test");
+}
@@ -0,0 +1,166 @@
+// host_clock.h
+// Host clocks shared by the capture tools.
+//  - mono_now_ns(): monotonic nanoseconds, QueryPerformanceCounter on Windows
+//    (the clock key_logger stamps with), CLOCK_MONOTONIC on Linux.
+//  - TickConverter: counter ticks -> nanoseconds at a fixed rate, exact
+//    (floor(ticks * 1e9 / rate)) over the whole 64-bit range, with a few
+//    multiplies per call instead of a division. qpc_to_ns() is the one for
+//    QPC; CLOCK_MONOTONIC is in nanoseconds already. host_clock_test.cpp
+//    checks it against 128-bit arithmetic.
+//  - local_time_now(): wall clock broken down to milliseconds, for file names
+//    and human-readable session metadata only.
+
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+#else
+#include <time.h>
+#endif
+
+struct LocalTime {
+    unsigned year, month, day, hour, minute, second, millisecond;
+};
+
+// 128-bit product from four 32 x 32-bit multiplies, for compilers without
+// a wide multiply (kept callable everywhere so host_clock_test can check it)
+static inline uint64_t mul_u64_split(uint64_t a, uint64_t b, uint64_t& hi) {
+    const uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    const uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    const uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+    const uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    return (mid << 32) | (uint32_t)ll;
+}
+
+// Full 128-bit product of a * b: returns the low half, hi gets the high half
+static inline uint64_t mul_u64_wide(uint64_t a, uint64_t b, uint64_t& hi) {
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 p = (unsigned __int128)a * b;
+    hi = (uint64_t)(p >> 64);
+    return (uint64_t)p;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return _umul128(a, b, &hi);
+#else
+    return mul_u64_split(a, b, hi);
+#endif
+}
+
+// ticks * 1e9 / rate as num / den (reduced), split into an integer and a
+// 64-bit fixed-point fraction: ns = ticks * whole + hi64(ticks * frac).
+// The fraction is rounded down, so that is at most 1 below the exact
+// result; one multiply-back against num / den corrects it. Exact as long as
+// the result fits 64 bits (584 years of nanoseconds).
+class TickConverter {
+public:
+    TickConverter() = default;
+
+    explicit TickConverter(uint64_t ticks_per_second) {
+        const uint64_t rate = ticks_per_second ? ticks_per_second : 1;
+        uint64_t a = 1000000000ULL, b = rate;
+        while (b) {                 // gcd
+            const uint64_t t = a % b;
+            a = b;
+            b = t;
+        }
+        num_ = 1000000000ULL / a;
+        den_ = rate / a;
+        whole_ = num_ / den_;
+        // floor(2^64 * (num % den) / den), by long division one bit at a time
+        uint64_t rem = num_ % den_;
+        frac_ = 0;
+        for (int i = 0; i < 64; i++) {
+            const bool carry = rem >> 63;
+            rem <<= 1;
+            frac_ <<= 1;
+            if (carry || rem >= den_) {
+                rem -= den_;
+                frac_ |= 1;
+            }
+        }
+    }
+
+    uint64_t to_ns(uint64_t ticks) const {
+        if (den_ == 1) return ticks * num_;         // e.g. 10 MHz QPC: 100 ns per tick
+        uint64_t frac_hi;
+        mul_u64_wide(ticks, frac_, frac_hi);
+        uint64_t ns = ticks * whole_ + frac_hi;
+
+        // Exact remainder ticks * num - ns * den is in [0, 2 * den)
+        uint64_t exact_hi, approx_hi;
+        const uint64_t exact_lo = mul_u64_wide(ticks, num_, exact_hi);
+        const uint64_t approx_lo = mul_u64_wide(ns, den_, approx_hi);
+        const uint64_t rem_lo = exact_lo - approx_lo;
+        const uint64_t rem_hi = exact_hi - approx_hi - (exact_lo < approx_lo);
+        if (rem_hi != 0 || rem_lo >= den_) ns++;
+        return ns;
+    }
+
+private:
+    uint64_t num_ = 1;
+    uint64_t den_ = 1;
+    uint64_t whole_ = 1;
+    uint64_t frac_ = 0;
+};
+
+#ifdef _WIN32
+
+static inline uint64_t qpc_frequency() {
+    static const uint64_t freq = [] {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return (uint64_t)f.QuadPart;
+    }();
+    return freq;
+}
+
+static inline uint64_t qpc_to_ns(uint64_t qpc) {
+    static const TickConverter conv(qpc_frequency());
+    return conv.to_ns(qpc);
+}
+
+static inline uint64_t mono_now_ns() {
+    LARGE_INTEGER c;
+    QueryPerformanceCounter(&c);
+    return qpc_to_ns((uint64_t)c.QuadPart);
+}
+
+static inline LocalTime local_time_now() {
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    return LocalTime{ st.wYear, st.wMonth, st.wDay,
+                      st.wHour, st.wMinute, st.wSecond, st.wMilliseconds };
+}
+
+#else
+
+static inline uint64_t mono_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline LocalTime local_time_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    struct tm tm;
+    localtime_r(&ts.tv_sec, &tm);
+    return LocalTime{ (unsigned)tm.tm_year + 1900, (unsigned)tm.tm_mon + 1, (unsigned)tm.tm_mday,
+                      (unsigned)tm.tm_hour, (unsigned)tm.tm_min, (unsigned)tm.tm_sec,
+                      (unsigned)(ts.tv_nsec / 1000000) };
+}
+
+#endif
+
+static inline double mono_now_s() {
+    return (double)mono_now_ns() * 1e-9;
+}
@@ -0,0 +1,118 @@
+// host_clock_test.cpp
+// Checks TickConverter (host_clock.h) against plain 128-bit arithmetic:
+// to_ns(t) == floor(t * 1e9 / rate) for QPC-like, odd, prime and extreme
+// rates, over small tick counts, every power of two and its neighbours, the
+// top of the range (the largest t whose result still fits 64 bits) and
+// random values. Also checks mul_u64_split, the multiply mul_u64_wide falls
+// back to on compilers without a 128-bit type.
+//
+// Build (Linux): g++ -std=c++17 -O2 -Wall host_clock_test.cpp -o host_clock_test
+// Run: host_clock_test   (exit code 0 when every check passes)
+
+#include "host_clock.h"
+
+#include <cstdio>
+
+#ifndef __SIZEOF_INT128__
+int main() {
+    std::printf("host_clock_test needs unsigned __int128 for the reference\n");
+    return 0;
+}
+#else
+
+#include "test_check.h"
+
+#include <random>
+#include <vector>
+
+typedef unsigned __int128 u128;
+
+static void test_mul_split() {
+    std::vector<uint64_t> values = { 0, 1, 2, 0xFFFFFFFFULL, 0x100000000ULL, 0x100000001ULL,
+                                     0x7FFFFFFFFFFFFFFFULL, 0x8000000000000000ULL, UINT64_MAX,
+                                     UINT64_MAX - 1, 1000000000ULL };
+    std::mt19937_64 rng(1);
+    for (int i = 0; i < 64; i++) values.push_back(rng() >> (rng() % 64));
+    int bad = 0;
+    for (uint64_t a : values) {
+        for (uint64_t b : values) {
+            uint64_t hi;
+            const uint64_t lo = mul_u64_split(a, b, hi);
+            const u128 p = (u128)a * b;
+            if (lo != (uint64_t)p || hi != (uint64_t)(p >> 64)) {
+                if (bad++ < 5) {
+                    std::printf("  %llx * %llx\n", (unsigned long long)a, (unsigned long long)b);
+                }
+            }
+        }
+    }
+    for (int i = 0; i < 1000000; i++) {
+        const uint64_t a = rng(), b = rng();
+        uint64_t hi;
+        const uint64_t lo = mul_u64_split(a, b, hi);
+        const u128 p = (u128)a * b;
+        if (lo != (uint64_t)p || hi != (uint64_t)(p >> 64)) bad++;
+    }
+    CHECK(bad == 0, "%d wrong products", bad);
+}
+
+// Compares to_ns(t) for one t; t beyond the 64-bit result range is skipped
+static bool check_one(const TickConverter& c, uint64_t rate, uint64_t t, int& bad) {
+    const u128 ref = (u128)t * 1000000000ULL / rate;
+    if (ref >> 64) return false;
+    const uint64_t got = c.to_ns(t);
+    if (got != (uint64_t)ref) {
+        if (bad++ < 5) {
+            std::printf("  rate=%llu t=%llu: %llu, expected %llu\n", (unsigned long long)rate,
+                        (unsigned long long)t, (unsigned long long)got, (unsigned long long)ref);
+        }
+    }
+    return true;
+}
+
+static void test_rate(uint64_t rate, std::mt19937_64& rng) {
+    const TickConverter c(rate);
+    int bad = 0;
+    for (uint64_t t = 0; t < 200000; t++) check_one(c, rate, t, bad);
+    for (int k = 1; k < 64; k++) {
+        const uint64_t p = 1ULL << k;
+        check_one(c, rate, p - 1, bad);
+        check_one(c, rate, p, bad);
+        check_one(c, rate, p + 1, bad);
+    }
+    check_one(c, rate, UINT64_MAX, bad);
+
+    // Largest t with floor(t * 1e9 / rate) < 2^64, and the ticks around it
+    const u128 limit = (((u128)1 << 64) * rate - 1) / 1000000000ULL;
+    const uint64_t top = limit >> 64 ? UINT64_MAX : (uint64_t)limit;
+    CHECK(check_one(c, rate, top, bad), "rate=%llu: top t=%llu out of range",
+          (unsigned long long)rate, (unsigned long long)top);
+    for (uint64_t d = 1; d < 1000 && d <= top; d++) check_one(c, rate, top - d, bad);
+    if (top < UINT64_MAX) check_one(c, rate, top + 1, bad);
+
+    for (int i = 0; i < 200000; i++) check_one(c, rate, rng() >> (rng() % 64), bad);
+    CHECK(bad == 0, "rate=%llu: %d wrong results", (unsigned long long)rate, bad);
+}
+
+int main() {
+    test_mul_split();
+
+    std::mt19937_64 rng(2);
+    std::vector<uint64_t> rates = {
+        1, 3, 7, 1000, 1000000, 10000000,   // 10 MHz: the usual QPC rate
+        3579545, 14318180, 2929687,         // ACPI PM timer, HPET, older QPC
+        19200000, 24000000, 2533333333ULL,  // ARM timers, a TSC-based QPC
+        999999937,                          // prime just below 1e9
+        1000000000, 1000000007, 4000000000ULL,
+        1ULL << 32, (1ULL << 32) + 1, 1ULL << 63, UINT64_MAX - 1, UINT64_MAX,
+    };
+    for (int i = 0; i < 200; i++) rates.push_back(1 + (rng() >> (rng() % 64)));
+    for (uint64_t rate : rates) test_rate(rate, rng);
+
+    // A default-constructed converter passes ticks through
+    CHECK(TickConverter().to_ns(12345) == 12345, "default converter");
+
+    return test_result("host_clock_test");
+}
+
+#endif
@@ -0,0 +1,252 @@
+// key_codes.h
+// Key identity shared by the key_logger backends. Keys are identified the way
+// RawInput reports them: PC scan code set 1 make code plus the E0/E1 prefix
+// flags, so the ScanCode/E0/E1 columns mean the same on every platform.
+//  - evdev_to_scan(): Linux input key code -> set 1 make code + prefix
+//  - hid_usage_to_scan(): HID keyboard usage (page 0x07) -> the same
+//  - scan_to_hid_usage(): the reverse; the usage is the canonical key ID in
+//    the logs, the same for a key whatever the host's layout or OS
+//  - scan_key_name() / hid_usage_name(): layout-independent English name
+//    (US key positions), for reports; the logs carry no names
+//  - key_index(): make code + prefix as a dense index below kScanKeyCount;
+//    event_key_index() adds a range for keys without a scan code
+// key_core_test.cpp checks the tables against each other and the evdev map.
+
+#pragma once
+
+#include <cstdint>
+
+struct ScanCode {
+    uint16_t make = 0;   // 0: no set 1 equivalent
+    uint8_t e0 = 0;
+    uint8_t e1 = 0;
+};
+
+// Dense key index: make code in the low byte, E0/E1 above it. Keys with no
+// set 1 equivalent (scan 0) are numbered from kScanKeyCount on by their
+// backend's own code (evdev key code, HID usage, Windows VKey), so they do
+// not all share index 0. A device only ever reports one kind of native code.
+static constexpr uint32_t kScanKeyCount = 1024;
+static constexpr uint32_t kNativeKeyCount = 1024;   // evdev codes end at 0x2FF
+static constexpr uint32_t kKeyIndexCount = kScanKeyCount + kNativeKeyCount;
+
+static inline uint32_t key_index(uint16_t scan, int e0, int e1) {
+    return (uint32_t)(scan & 0xFF) | ((uint32_t)(e0 != 0) << 8) | ((uint32_t)(e1 != 0) << 9);
+}
+
+static inline uint32_t event_key_index(uint16_t scan, int e0, int e1, uint32_t native) {
+    if (scan == 0) return kScanKeyCount + native % kNativeKeyCount;
+    return key_index(scan, e0, e1);
+}
+
+// evdev codes 1..88 are the set 1 make codes themselves (KEY_ESC .. KEY_F12);
+// the rest of the common keyboard keys are listed here.
+static inline ScanCode evdev_to_scan(uint16_t code) {
+    if (code >= 1 && code <= 88) return ScanCode{ code, 0, 0 };
+    switch (code) {
+    case 89:  return ScanCode{ 0x73, 0, 0 };   // KEY_RO
+    case 92:  return ScanCode{ 0x79, 0, 0 };   // KEY_HENKAN
+    case 93:  return ScanCode{ 0x70, 0, 0 };   // KEY_KATAKANAHIRAGANA
+    case 94:  return ScanCode{ 0x7B, 0, 0 };   // KEY_MUHENKAN
+    case 96:  return ScanCode{ 0x1C, 1, 0 };   // KEY_KPENTER
+    case 97:  return ScanCode{ 0x1D, 1, 0 };   // KEY_RIGHTCTRL
+    case 98:  return ScanCode{ 0x35, 1, 0 };   // KEY_KPSLASH
+    case 99:  return ScanCode{ 0x37, 1, 0 };   // KEY_SYSRQ
+    case 100: return ScanCode{ 0x38, 1, 0 };   // KEY_RIGHTALT
+    case 102: return ScanCode{ 0x47, 1, 0 };   // KEY_HOME
+    case 103: return ScanCode{ 0x48, 1, 0 };   // KEY_UP
+    case 104: return ScanCode{ 0x49, 1, 0 };   // KEY_PAGEUP
+    case 105: return ScanCode{ 0x4B, 1, 0 };   // KEY_LEFT
+    case 106: return ScanCode{ 0x4D, 1, 0 };   // KEY_RIGHT
+    case 107: return ScanCode{ 0x4F, 1, 0 };   // KEY_END
+    case 108: return ScanCode{ 0x50, 1, 0 };   // KEY_DOWN
+    case 109: return ScanCode{ 0x51, 1, 0 };   // KEY_PAGEDOWN
+    case 110: return ScanCode{ 0x52, 1, 0 };   // KEY_INSERT
+    case 111: return ScanCode{ 0x53, 1, 0 };   // KEY_DELETE
+    case 113: return ScanCode{ 0x20, 1, 0 };   // KEY_MUTE
+    case 114: return ScanCode{ 0x2E, 1, 0 };   // KEY_VOLUMEDOWN
+    case 115: return ScanCode{ 0x30, 1, 0 };   // KEY_VOLUMEUP
+    case 116: return ScanCode{ 0x5E, 1, 0 };   // KEY_POWER
+    case 117: return ScanCode{ 0x59, 0, 0 };   // KEY_KPEQUAL
+    case 119: return ScanCode{ 0x1D, 0, 1 };   // KEY_PAUSE
+    case 124: return ScanCode{ 0x7D, 0, 0 };   // KEY_YEN
+    case 125: return ScanCode{ 0x5B, 1, 0 };   // KEY_LEFTMETA
+    case 126: return ScanCode{ 0x5C, 1, 0 };   // KEY_RIGHTMETA
+    case 127: return ScanCode{ 0x5D, 1, 0 };   // KEY_COMPOSE
+    case 142: return ScanCode{ 0x5F, 1, 0 };   // KEY_SLEEP
+    case 143: return ScanCode{ 0x63, 1, 0 };   // KEY_WAKEUP
+    case 163: return ScanCode{ 0x19, 1, 0 };   // KEY_NEXTSONG
+    case 164: return ScanCode{ 0x22, 1, 0 };   // KEY_PLAYPAUSE
+    case 165: return ScanCode{ 0x10, 1, 0 };   // KEY_PREVIOUSSONG
+    case 166: return ScanCode{ 0x24, 1, 0 };   // KEY_STOPCD
+    }
+    if (code >= 183 && code <= 193) {           // KEY_F13 .. KEY_F23
+        return ScanCode{ (uint16_t)(0x64 + (code - 183)), 0, 0 };
+    }
+    if (code == 194) return ScanCode{ 0x76, 0, 0 };   // KEY_F24
+    return ScanCode{};
+}
+
+struct UsageScan {
+    uint8_t usage;
+    ScanCode scan;
+};
+
+// HID keyboard page usages and their set 1 equivalents (US key positions)
+static constexpr UsageScan kUsageScan[] = {
+    { 0x04, { 0x1E, 0, 0 } }, { 0x05, { 0x30, 0, 0 } }, { 0x06, { 0x2E, 0, 0 } },
+    { 0x07, { 0x20, 0, 0 } }, { 0x08, { 0x12, 0, 0 } }, { 0x09, { 0x21, 0, 0 } },
+    { 0x0A, { 0x22, 0, 0 } }, { 0x0B, { 0x23, 0, 0 } }, { 0x0C, { 0x17, 0, 0 } },
+    { 0x0D, { 0x24, 0, 0 } }, { 0x0E, { 0x25, 0, 0 } }, { 0x0F, { 0x26, 0, 0 } },
+    { 0x10, { 0x32, 0, 0 } }, { 0x11, { 0x31, 0, 0 } }, { 0x12, { 0x18, 0, 0 } },
+    { 0x13, { 0x19, 0, 0 } }, { 0x14, { 0x10, 0, 0 } }, { 0x15, { 0x13, 0, 0 } },
+    { 0x16, { 0x1F, 0, 0 } }, { 0x17, { 0x14, 0, 0 } }, { 0x18, { 0x16, 0, 0 } },
+    { 0x19, { 0x2F, 0, 0 } }, { 0x1A, { 0x11, 0, 0 } }, { 0x1B, { 0x2D, 0, 0 } },
+    { 0x1C, { 0x15, 0, 0 } }, { 0x1D, { 0x2C, 0, 0 } },
+    { 0x1E, { 0x02, 0, 0 } }, { 0x1F, { 0x03, 0, 0 } }, { 0x20, { 0x04, 0, 0 } },
+    { 0x21, { 0x05, 0, 0 } }, { 0x22, { 0x06, 0, 0 } }, { 0x23, { 0x07, 0, 0 } },
+    { 0x24, { 0x08, 0, 0 } }, { 0x25, { 0x09, 0, 0 } }, { 0x26, { 0x0A, 0, 0 } },
+    { 0x27, { 0x0B, 0, 0 } },
+    { 0x28, { 0x1C, 0, 0 } }, { 0x29, { 0x01, 0, 0 } }, { 0x2A, { 0x0E, 0, 0 } },
+    { 0x2B, { 0x0F, 0, 0 } }, { 0x2C, { 0x39, 0, 0 } }, { 0x2D, { 0x0C, 0, 0 } },
+    { 0x2E, { 0x0D, 0, 0 } }, { 0x2F, { 0x1A, 0, 0 } }, { 0x30, { 0x1B, 0, 0 } },
+    { 0x31, { 0x2B, 0, 0 } }, { 0x33, { 0x27, 0, 0 } }, { 0x34, { 0x28, 0, 0 } },
+    { 0x35, { 0x29, 0, 0 } }, { 0x36, { 0x33, 0, 0 } }, { 0x37, { 0x34, 0, 0 } },
+    { 0x38, { 0x35, 0, 0 } }, { 0x39, { 0x3A, 0, 0 } },
+    { 0x3A, { 0x3B, 0, 0 } }, { 0x3B, { 0x3C, 0, 0 } }, { 0x3C, { 0x3D, 0, 0 } },
+    { 0x3D, { 0x3E, 0, 0 } }, { 0x3E, { 0x3F, 0, 0 } }, { 0x3F, { 0x40, 0, 0 } },
+    { 0x40, { 0x41, 0, 0 } }, { 0x41, { 0x42, 0, 0 } }, { 0x42, { 0x43, 0, 0 } },
+    { 0x43, { 0x44, 0, 0 } }, { 0x44, { 0x57, 0, 0 } }, { 0x45, { 0x58, 0, 0 } },
+    { 0x46, { 0x37, 1, 0 } }, { 0x47, { 0x46, 0, 0 } }, { 0x48, { 0x1D, 0, 1 } },
+    { 0x49, { 0x52, 1, 0 } }, { 0x4A, { 0x47, 1, 0 } }, { 0x4B, { 0x49, 1, 0 } },
+    { 0x4C, { 0x53, 1, 0 } }, { 0x4D, { 0x4F, 1, 0 } }, { 0x4E, { 0x51, 1, 0 } },
+    { 0x4F, { 0x4D, 1, 0 } }, { 0x50, { 0x4B, 1, 0 } }, { 0x51, { 0x50, 1, 0 } },
+    { 0x52, { 0x48, 1, 0 } },
+    { 0x53, { 0x45, 0, 0 } }, { 0x54, { 0x35, 1, 0 } }, { 0x55, { 0x37, 0, 0 } },
+    { 0x56, { 0x4A, 0, 0 } }, { 0x57, { 0x4E, 0, 0 } }, { 0x58, { 0x1C, 1, 0 } },
+    { 0x59, { 0x4F, 0, 0 } }, { 0x5A, { 0x50, 0, 0 } }, { 0x5B, { 0x51, 0, 0 } },
+    { 0x5C, { 0x4B, 0, 0 } }, { 0x5D, { 0x4C, 0, 0 } }, { 0x5E, { 0x4D, 0, 0 } },
+    { 0x5F, { 0x47, 0, 0 } }, { 0x60, { 0x48, 0, 0 } }, { 0x61, { 0x49, 0, 0 } },
+    { 0x62, { 0x52, 0, 0 } }, { 0x63, { 0x53, 0, 0 } },
+    { 0x64, { 0x56, 0, 0 } }, { 0x65, { 0x5D, 1, 0 } }, { 0x66, { 0x5E, 1, 0 } },
+    { 0x67, { 0x59, 0, 0 } },
+    { 0x68, { 0x64, 0, 0 } }, { 0x69, { 0x65, 0, 0 } }, { 0x6A, { 0x66, 0, 0 } },
+    { 0x6B, { 0x67, 0, 0 } }, { 0x6C, { 0x68, 0, 0 } }, { 0x6D, { 0x69, 0, 0 } },
+    { 0x6E, { 0x6A, 0, 0 } }, { 0x6F, { 0x6B, 0, 0 } }, { 0x70, { 0x6C, 0, 0 } },
+    { 0x71, { 0x6D, 0, 0 } }, { 0x72, { 0x6E, 0, 0 } }, { 0x73, { 0x76, 0, 0 } },
+    { 0x7F, { 0x20, 1, 0 } }, { 0x80, { 0x30, 1, 0 } }, { 0x81, { 0x2E, 1, 0 } },
+    { 0x87, { 0x73, 0, 0 } }, { 0x88, { 0x70, 0, 0 } }, { 0x89, { 0x7D, 0, 0 } },
+    { 0x8A, { 0x79, 0, 0 } }, { 0x8B, { 0x7B, 0, 0 } },
+    { 0xE0, { 0x1D, 0, 0 } }, { 0xE1, { 0x2A, 0, 0 } }, { 0xE2, { 0x38, 0, 0 } },
+    { 0xE3, { 0x5B, 1, 0 } }, { 0xE4, { 0x1D, 1, 0 } }, { 0xE5, { 0x36, 0, 0 } },
+    { 0xE6, { 0x38, 1, 0 } }, { 0xE7, { 0x5C, 1, 0 } },
+};
+
+struct UsageScanTable {
+    ScanCode by_usage[256];
+};
+
+static constexpr UsageScanTable make_usage_scan_table() {
+    UsageScanTable t{};
+    for (const UsageScan& u : kUsageScan) t.by_usage[u.usage] = u.scan;
+    return t;
+}
+
+static constexpr UsageScanTable kUsageToScan = make_usage_scan_table();
+
+static constexpr ScanCode hid_usage_to_scan(uint8_t usage) {
+    return kUsageToScan.by_usage[usage];
+}
+
+// The same table inverted, indexed by key_index(); 0: no usage
+struct ScanUsageTable {
+    uint8_t by_key[kScanKeyCount];
+};
+
+static constexpr ScanUsageTable make_scan_usage_table() {
+    ScanUsageTable t{};
+    for (const UsageScan& u : kUsageScan) {
+        const uint32_t i = (uint32_t)(u.scan.make & 0xFF) | ((uint32_t)u.scan.e0 << 8) | ((uint32_t)u.scan.e1 << 9);
+        if (t.by_key[i] == 0) t.by_key[i] = u.usage;
+    }
+    return t;
+}
+
+static constexpr ScanUsageTable kScanToUsage = make_scan_usage_table();
+
+static constexpr uint8_t scan_to_hid_usage(uint16_t scan, int e0, int e1) {
+    return kScanToUsage.by_key[(scan & 0xFF) | ((e0 != 0) << 8) | ((e1 != 0) << 9)];
+}
+
+static_assert(scan_to_hid_usage(0x1E, 0, 0) == 0x04, "A");
+static_assert(scan_to_hid_usage(0x48, 1, 0) == 0x52, "Up");
+static_assert(scan_to_hid_usage(0x1D, 0, 1) == 0x48, "Pause");
+
+// Names for make codes without prefix, indexed by make code
+static const char* const kScanNames[0x80] = {
+    nullptr, "Esc", "1", "2", "3", "4", "5", "6",
+    "7", "8", "9", "0", "-", "=", "Backspace", "Tab",
+    "Q", "W", "E", "R", "T", "Y", "U", "I",
+    "O", "P", "[", "]", "Enter", "Ctrl", "A", "S",
+    "D", "F", "G", "H", "J", "K", "L", ";",
+    "'", "`", "Shift", "\\", "Z", "X", "C", "V",
+    "B", "N", "M", ",", ".", "/", "Right Shift", "Num *",
+    "Alt", "Space", "Caps Lock", "F1", "F2", "F3", "F4", "F5",
+    "F6", "F7", "F8", "F9", "F10", "Num Lock", "Scroll Lock", "Num 7",
+    "Num 8", "Num 9", "Num -", "Num 4", "Num 5", "Num 6", "Num +", "Num 1",
+    "Num 2", "Num 3", "Num 0", "Num Del", "Sys Req", nullptr, "<>", "F11",
+    "F12", "Num =", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+    nullptr, nullptr, nullptr, nullptr, "F13", "F14", "F15", "F16",
+    "F17", "F18", "F19", "F20", "F21", "F22", "F23", nullptr,
+    "Kana", nullptr, nullptr, "Ro", nullptr, nullptr, "F24", nullptr,
+    nullptr, "Henkan", nullptr, "Muhenkan", nullptr, "Yen", nullptr, nullptr,
+};
+
+// Names for E0-prefixed make codes
+static inline const char* scan_name_e0(uint16_t make) {
+    switch (make) {
+    case 0x10: return "Previous Track";
+    case 0x19: return "Next Track";
+    case 0x1C: return "Num Enter";
+    case 0x1D: return "Right Ctrl";
+    case 0x20: return "Mute";
+    case 0x22: return "Play/Pause";
+    case 0x24: return "Stop";
+    case 0x2E: return "Volume Down";
+    case 0x30: return "Volume Up";
+    case 0x35: return "Num /";
+    case 0x37: return "Prnt Scrn";
+    case 0x38: return "Right Alt";
+    case 0x45: return "Num Lock";
+    case 0x47: return "Home";
+    case 0x48: return "Up";
+    case 0x49: return "Page Up";
+    case 0x4B: return "Left";
+    case 0x4D: return "Right";
+    case 0x4F: return "End";
+    case 0x50: return "Down";
+    case 0x51: return "Page Down";
+    case 0x52: return "Insert";
+    case 0x53: return "Delete";
+    case 0x5B: return "Left Windows";
+    case 0x5C: return "Right Windows";
+    case 0x5D: return "Application";
+    case 0x5E: return "Power";
+    case 0x5F: return "Sleep";
+    case 0x63: return "Wake";
+    }
+    return nullptr;
+}
+
+// nullptr if the key has no name here
+static inline const char* scan_key_name(uint16_t make, int e0, int e1) {
+    if (e1) return make == 0x1D ? "Pause" : nullptr;
+    if (e0) return scan_name_e0(make);
+    return make < 0x80 ? kScanNames[make] : nullptr;
+}
+
+// nullptr if the usage has no set 1 equivalent or no name here
+static inline const char* hid_usage_name(uint8_t usage) {
+    const ScanCode sc = hid_usage_to_scan(usage);
+    return sc.make ? scan_key_name(sc.make, sc.e0, sc.e1) : nullptr;
+}
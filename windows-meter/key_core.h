@@ -0,0 +1,332 @@
+// key_core.h
+// Platform-independent event processing of key_logger. The OS backends only
+// fill a KeyEvent and hand it to KeyLogWriter::push(); everything after that
+// works on fixed-size records and memory allocated up front:
+//  - Debouncer:    debounce strategy for the filtered stream (debounce.h)
+//  - encode_key_row(): CSV row formatted into a caller buffer
+//  - KeyLogCore:   appends rows to preallocated buffers and writes them out
+//    in one fwrite per stream when full or on flush()
+//  - KeyLogWriter:  runs a KeyLogCore on a background thread behind a
+//    lock-free ring, so the capture thread never waits on file I/O
+// key_core_test.cpp covers the row format and KeyLogCore on temporary files.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "debounce.h"
+#include "host_clock.h"
+#include "key_codes.h"
+#include "spsc_ring.h"
+
+static const char* const kKeyCsvHeader =
+    "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,Usage,KernelTimestamp_ns\n";
+
+// Field 7 of a row is the HID usage when the log's header names it Usage;
+// logs written before that hold a localized KeyName there, where a digit
+// key's name ("4") would read as a usage
+static inline bool key_csv_has_usage(std::string_view header) {
+    size_t pos = 0;
+    for (int i = 0; i < 7; i++) {
+        pos = header.find(',', pos);
+        if (pos == std::string_view::npos) return false;
+        pos++;
+    }
+    const size_t end = header.find_first_of(",\r\n", pos);
+    return header.substr(pos, end == std::string_view::npos ? std::string_view::npos : end - pos) == "Usage";
+}
+
+// One key edge as delivered by a backend
+struct KeyEvent {
+    uint64_t device;
+    uint64_t host_ns;       // when the capture thread received it
+    int64_t kernel_ns;      // kernel event time (evdev), -1 if not available
+    uint32_t vkey;          // Windows virtual key / evdev key code / HID usage
+    uint16_t scan;          // set 1 make code
+    uint8_t e0;
+    uint8_t e1;
+    bool is_break;          // UP
+    uint8_t usage;          // HID keyboard usage (key_codes.h), 0: none
+};
+
+// ---- CSV encoding ----
+static constexpr size_t kKeyRowMax = 160;
+
+static inline char* key_put_u64(char* p, uint64_t v) {
+    char tmp[20];
+    int n = 0;
+    do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+    while (n) *p++ = tmp[--n];
+    return p;
+}
+
+// Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,Usage,KernelTimestamp_ns
+// out must hold kKeyRowMax bytes; returns the row length
+static inline size_t encode_key_row(char* out, const KeyEvent& k) {
+    char* p = out;
+    p = key_put_u64(p, k.device);        *p++ = ',';
+    p = key_put_u64(p, k.vkey);          *p++ = ',';
+    p = key_put_u64(p, k.scan);          *p++ = ',';
+    *p++ = (char)('0' + (k.e0 != 0));    *p++ = ',';
+    *p++ = (char)('0' + (k.e1 != 0));    *p++ = ',';
+    if (k.is_break) { std::memcpy(p, "UP", 2); p += 2; }
+    else          { std::memcpy(p, "DOWN", 4); p += 4; }
+    *p++ = ',';
+    p = key_put_u64(p, k.host_ns);       *p++ = ',';
+    if (k.usage) p = key_put_u64(p, k.usage);
+    *p++ = ',';
+    if (k.kernel_ns >= 0) p = key_put_u64(p, (uint64_t)k.kernel_ns);
+    *p++ = '\n';
+    return (size_t)(p - out);
+}
+
+// ---- Raw + filtered streams ----
+class KeyLogCore {
+public:
+    static constexpr size_t kBufferBytes = 64 * 1024;
+
+    KeyLogCore() {
+        raw_.data.resize(kBufferBytes);
+        filtered_.data.resize(kBufferBytes);
+    }
+
+    // Takes over both files (closed by close())
+    void open(std::FILE* raw, std::FILE* filtered, const DebounceSpec& debounce) {
+        raw_.f = raw;
+        filtered_.f = filtered;
+        debounce_ = Debouncer<KeyEvent>(debounce);
+        append(raw_, kKeyCsvHeader, std::strlen(kKeyCsvHeader));
+        append(filtered_, kKeyCsvHeader, std::strlen(kKeyCsvHeader));
+        flush();
+    }
+
+    void process(const KeyEvent& k) {
+        // ---- RAW STREAM: log everything (including bounce/chatter) ----
+        char row[kKeyRowMax];
+        append(raw_, row, encode_key_row(row, k));
+
+        // ---- FILTERED STREAM: one DOWN per accepted press, no UP ----
+        // Debounce on the earliest stamp available for the edge
+        const uint64_t t_ns = k.kernel_ns >= 0 ? (uint64_t)k.kernel_ns : k.host_ns;
+        debounce_.edge(k.device, event_key_index(k.scan, k.e0, k.e1, k.vkey), !k.is_break, t_ns, k, OnAccept{ this });
+    }
+
+    // Comment line ("# ...") into both streams, e.g. session and device info
+    void note(const std::string& line) {
+        append(raw_, line.data(), line.size());
+        append(raw_, "\n", 1);
+        append(filtered_, line.data(), line.size());
+        append(filtered_, "\n", 1);
+    }
+
+    // Presses a deferred strategy has settled by now_ns (same clock as the events)
+    void tick(uint64_t now_ns) { debounce_.tick(now_ns, OnAccept{ this }); }
+
+    // End of capture: settles every pending press
+    void finish() { debounce_.finish(OnAccept{ this }); }
+
+    size_t buffered() const { return raw_.used + filtered_.used; }
+
+    // Hands buffered rows to the OS
+    void flush() {
+        write(raw_);
+        write(filtered_);
+    }
+
+    // flush() and asks the OS to put the files on disk
+    void checkpoint() {
+        flush();
+        sync_file(raw_.f);
+        sync_file(filtered_.f);
+    }
+
+    void close() {
+        flush();
+        if (raw_.f) std::fclose(raw_.f);
+        if (filtered_.f) std::fclose(filtered_.f);
+        raw_.f = filtered_.f = nullptr;
+    }
+
+private:
+    struct Stream {
+        std::FILE* f = nullptr;
+        std::vector<char> data;
+        size_t used = 0;
+    };
+
+    // The accepted press is logged as its onset row
+    struct OnAccept {
+        KeyLogCore* core;
+        void operator()(const KeyEvent& onset, uint64_t, uint64_t) const {
+            char row[kKeyRowMax];
+            core->append(core->filtered_, row, encode_key_row(row, onset));
+        }
+    };
+
+    void append(Stream& s, const char* p, size_t n) {
+        if (s.used + n > s.data.size()) write(s);
+        std::memcpy(s.data.data() + s.used, p, n);
+        s.used += n;
+    }
+
+    static void sync_file(std::FILE* f) {
+        if (!f) return;
+#ifdef _WIN32
+        _commit(_fileno(f));
+#else
+        fsync(fileno(f));
+#endif
+    }
+
+    static void write(Stream& s) {
+        if (!s.f || s.used == 0) return;
+        std::fwrite(s.data.data(), 1, s.used, s.f);
+        std::fflush(s.f);
+        s.used = 0;
+    }
+
+    Debouncer<KeyEvent> debounce_;
+    Stream raw_;
+    Stream filtered_;
+};
+
+// ---- Background writer ----
+// The capture thread only copies a KeyEvent into the ring (push()); the
+// writer thread debounces, encodes and writes. Rows reach the OS at
+// least every kFlushIntervalNs and the disk every kCheckpointNs. stop()
+// drains what is queued, but gives up after a bounded time.
+class KeyLogWriter {
+public:
+    static constexpr size_t kRingEvents = 1 << 16;
+    static constexpr uint64_t kFlushIntervalNs = 100000000ULL;      // 100 ms
+    static constexpr uint64_t kCheckpointNs = 2000000000ULL;        // 2 s
+    static constexpr uint64_t kStopTimeoutNs = 2000000000ULL;
+    // Debounce time runs this far behind the clock: an edge stamped earlier
+    // may still be in the kernel buffer or the ring, and the Debouncer needs
+    // edges in time order
+    static constexpr uint64_t kTickLagNs = 50000000ULL;             // 50 ms
+
+    KeyLogWriter() : ring_(kRingEvents) {}
+    ~KeyLogWriter() { stop(); }
+
+    // Lines before start() go right after the column header; later
+    // ones (devices seen mid-capture) are queued for the writer thread
+    void note(const std::string& line) {
+        if (!thread_.joinable()) {
+            core_.note(line);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(notes_mutex_);
+        notes_.push_back(line);
+    }
+
+    // Takes over both files and writes the column header
+    void open(std::FILE* raw, std::FILE* filtered, const DebounceSpec& debounce) {
+        core_.open(raw, filtered, debounce);
+    }
+
+    // live_clock: event times are on mono_now_ns(), so deferred presses can
+    // be settled while no key is touched
+    void start(bool live_clock) {
+        live_clock_ = live_clock;
+        stop_.store(false, std::memory_order_relaxed);
+        thread_ = std::thread([this] { run(); });
+    }
+
+    // Capture thread. Live capture never blocks: a full ring drops the event
+    // (counted). Replays pass wait=true and are paced by the writer instead.
+    void push(const KeyEvent& k, bool wait = false) {
+        while (!ring_.try_push(k)) {
+            if (!wait || !thread_.joinable()) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // Writes what is queued (up to kStopTimeoutNs), closes the files.
+    // Returns the number of events that never reached the files.
+    uint64_t stop() {
+        if (!thread_.joinable()) return lost();
+        stop_.store(true, std::memory_order_release);
+        thread_.join();
+        core_.finish();
+        core_.checkpoint();
+        core_.close();
+        return lost();
+    }
+
+    uint64_t lost() const {
+        return dropped_.load(std::memory_order_relaxed) + abandoned_;
+    }
+
+private:
+    bool drain() {
+        bool any = false;
+        {
+            std::lock_guard<std::mutex> lock(notes_mutex_);
+            for (const std::string& line : notes_) core_.note(line);
+            any = !notes_.empty();
+            notes_.clear();
+        }
+        while (KeyEvent* k = ring_.front()) {
+            core_.process(*k);
+            ring_.pop();
+            any = true;
+        }
+        return any;
+    }
+
+    void run() {
+        uint64_t last_flush = mono_now_ns();
+        uint64_t last_checkpoint = last_flush;
+        while (!stop_.load(std::memory_order_acquire)) {
+            const bool any = drain();
+            const uint64_t now = mono_now_ns();
+            if (live_clock_ && now > kTickLagNs) core_.tick(now - kTickLagNs);
+            if (now - last_checkpoint >= kCheckpointNs) {
+                core_.checkpoint();
+                last_checkpoint = last_flush = now;
+            } else if (now - last_flush >= kFlushIntervalNs && core_.buffered() > 0) {
+                core_.flush();
+                last_flush = now;
+            }
+            if (!any) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+
+        // Producer may still be pushing; take what is there, bounded in time
+        const uint64_t deadline = mono_now_ns() + kStopTimeoutNs;
+        while (drain() && mono_now_ns() < deadline) {}
+        while (ring_.front()) {
+            ring_.pop();
+            abandoned_++;
+        }
+    }
+
+    KeyLogCore core_;
+    SpscRing<KeyEvent> ring_;
+    std::thread thread_;
+    bool live_clock_ = false;
+    std::mutex notes_mutex_;
+    std::vector<std::string> notes_;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> dropped_{0};
+    uint64_t abandoned_ = 0;        // writer thread, read after join
+};
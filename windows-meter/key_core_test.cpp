@@ -0,0 +1,304 @@
+// key_core_test.cpp
+// Checks key_logger's platform-independent core without a keyboard: the
+// scan code <-> HID usage tables and the evdev mapping (key_codes.h), the
+// dense key index, the CSV row encoder, how a log header tells Usage from
+// the KeyName of older logs, and KeyLogCore's raw and filtered streams,
+// written to temporary files (key_core.h).
+//
+// Build (MSVC):  cl /std:c++17 /O2 /EHsc key_core_test.cpp
+// Build (Linux): g++ -std=c++17 -O2 -Wall key_core_test.cpp -o key_core_test
+// Run: key_core_test   (exit code 0 when every check passes)
+
+#include "key_core.h"
+#include "test_check.h"
+
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+
+static bool same_scan(const ScanCode& a, const ScanCode& b) {
+    return a.make == b.make && a.e0 == b.e0 && a.e1 == b.e1;
+}
+
+// Every usage in the table maps to its scan code and back; no two usages
+// share a key, so the inverse loses nothing
+static void test_usage_tables() {
+    bool listed[256] = {};
+    for (const UsageScan& u : kUsageScan) {
+        listed[u.usage] = true;
+        const ScanCode sc = hid_usage_to_scan(u.usage);
+        CHECK(same_scan(sc, u.scan), "usage %02X -> %02X/%d/%d", u.usage, sc.make, sc.e0, sc.e1);
+        const uint8_t back = scan_to_hid_usage(u.scan.make, u.scan.e0, u.scan.e1);
+        CHECK(back == u.usage, "usage %02X -> scan %02X/%d/%d -> usage %02X", u.usage, u.scan.make,
+              u.scan.e0, u.scan.e1, back);
+        CHECK(hid_usage_name(u.usage) != nullptr, "usage %02X has no name", u.usage);
+    }
+    for (int usage = 0; usage < 256; usage++) {
+        if (listed[usage]) continue;
+        CHECK(hid_usage_to_scan((uint8_t)usage).make == 0, "unlisted usage %02X has a scan code", usage);
+        CHECK(hid_usage_name((uint8_t)usage) == nullptr, "unlisted usage %02X has a name", usage);
+    }
+
+    // The other way round, over every key index
+    for (uint32_t i = 0; i < kScanKeyCount; i++) {
+        const uint8_t usage = kScanToUsage.by_key[i];
+        if (!usage) continue;
+        const ScanCode sc = hid_usage_to_scan(usage);
+        CHECK(key_index(sc.make, sc.e0, sc.e1) == i, "key %03X -> usage %02X -> key %03X", (unsigned)i, usage,
+              (unsigned)key_index(sc.make, sc.e0, sc.e1));
+    }
+
+    // The prefix flags tell keys apart: Ctrl, Right Ctrl, Pause
+    CHECK(scan_to_hid_usage(0x1D, 0, 0) == 0xE0, "Ctrl");
+    CHECK(scan_to_hid_usage(0x1D, 1, 0) == 0xE4, "Right Ctrl");
+    CHECK(scan_to_hid_usage(0x1D, 0, 1) == 0x48, "Pause");
+    CHECK(scan_to_hid_usage(0x1C, 1, 0) == 0x58, "Num Enter");
+    CHECK(scan_to_hid_usage(0x00, 0, 0) == 0, "scan 0");
+    CHECK(scan_to_hid_usage(0x7F, 0, 0) == 0, "unknown scan 7F");
+    CHECK(scan_to_hid_usage(0x10, 0, 1) == 0, "E1 without Pause");
+}
+
+static void test_names() {
+    struct { uint8_t usage; const char* name; } const names[] = {
+        { 0x04, "A" }, { 0x1E, "1" }, { 0x2C, "Space" }, { 0x48, "Pause" }, { 0x52, "Up" },
+        { 0x53, "Num Lock" }, { 0x58, "Num Enter" }, { 0x73, "F24" }, { 0xE4, "Right Ctrl" },
+    };
+    for (const auto& n : names) {
+        const char* got = hid_usage_name(n.usage);
+        CHECK(got && std::strcmp(got, n.name) == 0, "usage %02X: \"%s\", want \"%s\"", n.usage,
+              got ? got : "(null)", n.name);
+    }
+    CHECK(scan_key_name(0x10, 0, 1) == nullptr, "E1 10 has no name");
+    CHECK(scan_key_name(0x01, 1, 0) == nullptr, "E0 01 has no name");
+    CHECK(scan_key_name(0x80, 0, 0) == nullptr, "make codes end at 7F");
+}
+
+// evdev codes reach the same usage as the HID path for the same key
+static void test_evdev() {
+    struct { uint16_t code; uint8_t usage; } const keys[] = {
+        { 1, 0x29 },   { 30, 0x04 },  { 57, 0x2C },  { 88, 0x45 },  { 96, 0x58 },  { 97, 0xE4 },
+        { 100, 0xE6 }, { 103, 0x52 }, { 111, 0x4C }, { 119, 0x48 }, { 125, 0xE3 }, { 183, 0x68 },
+        { 193, 0x72 }, { 194, 0x73 },
+    };
+    for (const auto& k : keys) {
+        const ScanCode sc = evdev_to_scan(k.code);
+        const uint8_t usage = scan_to_hid_usage(sc.make, sc.e0, sc.e1);
+        CHECK(usage == k.usage, "evdev %u -> scan %02X/%d/%d -> usage %02X, want %02X", k.code, sc.make,
+              sc.e0, sc.e1, usage, k.usage);
+    }
+    const uint16_t unknown[] = { 0, 90, 112, 240, 0x2FF };
+    for (uint16_t code : unknown) {
+        CHECK(evdev_to_scan(code).make == 0, "evdev %u has a scan code", code);
+    }
+}
+
+static void test_key_index() {
+    CHECK(key_index(0x1D, 0, 0) != key_index(0x1D, 1, 0) && key_index(0x1D, 1, 0) != key_index(0x1D, 0, 1),
+          "prefixes share an index");
+    CHECK(key_index(0x1D, 1, 1) == 0x31D && key_index(0x1D, 5, 0) == 0x11D, "prefix flags are bits 8 and 9");
+
+    // Keys without a scan code are told apart by their native code
+    const uint32_t a = event_key_index(0, 0, 0, 240);
+    const uint32_t b = event_key_index(0, 0, 0, 241);
+    CHECK(a != b, "native 240 and 241 share index %u", (unsigned)a);
+    CHECK(a >= kScanKeyCount && a < kKeyIndexCount && b < kKeyIndexCount, "native index out of its range");
+    CHECK(event_key_index(0, 0, 0, 0xFFFFFFFF) < kKeyIndexCount, "native code wraps into the range");
+    CHECK(event_key_index(0x1E, 0, 0, 30) == key_index(0x1E, 0, 0), "scan code wins over the native code");
+}
+
+static void test_encode_row() {
+    char row[kKeyRowMax];
+    KeyEvent k{ 3, 123456789, -1, 65, 0x1E, 0, 0, false, 0x04 };
+    std::string got(row, encode_key_row(row, k));
+    CHECK(got == "3,65,30,0,0,DOWN,123456789,4,\n", "\"%s\"", got.c_str());
+
+    // No usage: empty column; a kernel stamp of 0 is still a stamp
+    k = KeyEvent{ 0, 0, 0, 0, 0x48, 1, 0, true, 0 };
+    got.assign(row, encode_key_row(row, k));
+    CHECK(got == "0,0,72,1,0,UP,0,,0\n", "\"%s\"", got.c_str());
+
+    // Prefix flags are 0/1 whatever the backend stored
+    k = KeyEvent{ 1, 2, 5, 19, 0x1D, 0, 7, false, 0x48 };
+    got.assign(row, encode_key_row(row, k));
+    CHECK(got == "1,19,29,0,1,DOWN,2,72,5\n", "\"%s\"", got.c_str());
+
+    // Widest row fits the buffer
+    k = KeyEvent{ UINT64_MAX, UINT64_MAX, INT64_MAX, UINT32_MAX, 0xFFFF, 1, 1, false, 0xFF };
+    const size_t n = encode_key_row(row, k);
+    got.assign(row, n);
+    CHECK(n <= kKeyRowMax, "widest row is %zu bytes", n);
+    CHECK(got == "18446744073709551615,4294967295,65535,1,1,DOWN,18446744073709551615,255,"
+                 "9223372036854775807\n", "\"%s\"", got.c_str());
+}
+
+// Field 7 is a usage only under the current header, not the KeyName of
+// older logs
+static void test_csv_header() {
+    CHECK(key_csv_has_usage(kKeyCsvHeader), "current header");
+    const char* const usage[] = {
+        "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,Usage,KernelTimestamp_ns",
+        "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,Usage,KernelTimestamp_ns\r",
+        "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,Usage",
+        "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,Usage\r\n",
+    };
+    for (const char* h : usage) CHECK(key_csv_has_usage(h), "\"%s\"", h);
+    const char* const no_usage[] = {
+        "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,KeyName,KernelTimestamp_ns",
+        "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,KeyName",
+        "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns",
+        "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,",
+        "Device,VKey,ScanCode,E0,E1,Edge,Usage,HostTimestamp_ns",
+        "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,UsageID,KernelTimestamp_ns",
+        "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,Usage ,KernelTimestamp_ns",
+        "",
+    };
+    for (const char* h : no_usage) CHECK(!key_csv_has_usage(h), "\"%s\"", h);
+}
+
+// Everything written to f so far
+static std::string contents(std::FILE* f) {
+    std::fflush(f);
+    std::rewind(f);
+    std::string s;
+    char buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) s.append(buf, n);
+    std::fseek(f, 0, SEEK_END);
+    return s;
+}
+
+static KeyEvent key(uint64_t device, uint16_t scan, bool down, uint64_t host_ms, int64_t kernel_ms = -1) {
+    KeyEvent k{};
+    k.device = device;
+    k.host_ns = host_ms * 1000000;
+    k.kernel_ns = kernel_ms < 0 ? -1 : kernel_ms * 1000000;
+    k.vkey = scan;
+    k.scan = scan;
+    k.is_break = !down;
+    k.usage = scan_to_hid_usage(scan, 0, 0);
+    return k;
+}
+
+static std::string rows(std::initializer_list<KeyEvent> keys) {
+    std::string s;
+    char row[kKeyRowMax];
+    for (const KeyEvent& k : keys) s.append(row, encode_key_row(row, k));
+    return s;
+}
+
+static void test_core_eager() {
+    std::FILE* raw = std::tmpfile();
+    std::FILE* filtered = std::tmpfile();
+    CHECK(raw && filtered, "tmpfile failed");
+    if (!raw || !filtered) return;
+
+    DebounceSpec spec;
+    parse_debounce_spec("eager:5", spec);
+    KeyLogCore core;
+    core.open(raw, filtered, spec);
+    CHECK(contents(raw) == kKeyCsvHeader && contents(filtered) == kKeyCsvHeader, "open writes the header");
+    core.note("# device 3");
+
+    // A bounces 2 ms after its press; the press at 10 ms is a new one
+    const KeyEvent a[] = { key(3, 0x1E, true, 1), key(3, 0x1E, false, 2), key(3, 0x1E, true, 3),
+                           key(3, 0x1E, false, 4), key(3, 0x1E, true, 10), key(3, 0x1E, false, 11) };
+    // B: the kernel stamps 6 ms apart, the host 4 ms; the kernel one counts
+    const KeyEvent b[] = { key(3, 0x30, true, 100, 50), key(3, 0x30, false, 101, 51),
+                           key(3, 0x30, true, 104, 56) };
+    // A on another device has its own state
+    const KeyEvent c = key(4, 0x1E, true, 12);
+    for (const KeyEvent& k : a) core.process(k);
+    for (const KeyEvent& k : b) core.process(k);
+    core.process(c);
+    core.finish();
+    core.flush();
+
+    const std::string want_raw = std::string(kKeyCsvHeader) + "# device 3\n" +
+                                 rows({ a[0], a[1], a[2], a[3], a[4], a[5], b[0], b[1], b[2], c });
+    const std::string want_filtered = std::string(kKeyCsvHeader) + "# device 3\n" +
+                                      rows({ a[0], a[4], b[0], b[2], c });
+    const std::string got_raw = contents(raw);
+    const std::string got_filtered = contents(filtered);
+    CHECK(got_raw == want_raw, "raw:\n%s", got_raw.c_str());
+    CHECK(got_filtered == want_filtered, "filtered:\n%swant:\n%s", got_filtered.c_str(), want_filtered.c_str());
+    core.close();
+}
+
+// Deferred presses are logged by their onset row, once tick() or finish()
+// has let the threshold pass
+static void test_core_deferred() {
+    std::FILE* raw = std::tmpfile();
+    std::FILE* filtered = std::tmpfile();
+    CHECK(raw && filtered, "tmpfile failed");
+    if (!raw || !filtered) return;
+
+    DebounceSpec spec;
+    parse_debounce_spec("deferred:5", spec);
+    KeyLogCore core;
+    core.open(raw, filtered, spec);
+
+    const KeyEvent a[] = { key(1, 0x1E, true, 1), key(1, 0x1E, false, 2), key(1, 0x1E, true, 3) };
+    for (const KeyEvent& k : a) core.process(k);
+    core.tick(7999999);
+    core.flush();
+    CHECK(contents(filtered) == kKeyCsvHeader, "accepted before the threshold");
+    core.tick(8000000);
+    core.flush();
+    const std::string once = std::string(kKeyCsvHeader) + rows({ a[0] });
+    CHECK(contents(filtered) == once, "tick(8 ms) should log the onset row at 1 ms");
+    core.tick(100000000);
+    core.flush();
+    CHECK(contents(filtered) == once, "a press is logged once");
+
+    const KeyEvent b = key(1, 0x30, true, 200);
+    core.process(b);
+    core.flush();
+    CHECK(contents(filtered) == once, "B has not settled");
+    core.finish();
+    core.flush();
+    CHECK(contents(filtered) == once + rows({ b }), "finish() settles B");
+    core.close();
+}
+
+// More rows than the 64 KiB buffers hold are written out in order
+static void test_core_buffer() {
+    std::FILE* raw = std::tmpfile();
+    std::FILE* filtered = std::tmpfile();
+    CHECK(raw && filtered, "tmpfile failed");
+    if (!raw || !filtered) return;
+
+    DebounceSpec spec;
+    parse_debounce_spec("eager:5", spec);
+    KeyLogCore core;
+    core.open(raw, filtered, spec);
+
+    std::string want_raw = kKeyCsvHeader;
+    std::string want_filtered = kKeyCsvHeader;
+    char row[kKeyRowMax];
+    for (uint64_t i = 0; i < 4000; i++) {
+        const KeyEvent k = key(7, 0x1E, i % 2 == 0, 1000 + i * 10);
+        core.process(k);
+        want_raw.append(row, encode_key_row(row, k));
+        if (i % 2 == 0) want_filtered.append(row, encode_key_row(row, k));
+    }
+    CHECK(want_raw.size() > KeyLogCore::kBufferBytes, "test rows fit the buffer (%zu bytes)", want_raw.size());
+    core.flush();
+    CHECK(core.buffered() == 0, "%zu bytes left after flush()", core.buffered());
+    CHECK(contents(raw) == want_raw, "raw stream differs");
+    CHECK(contents(filtered) == want_filtered, "filtered stream differs");
+    core.close();
+}
+
+int main() {
+    test_usage_tables();
+    test_names();
+    test_evdev();
+    test_key_index();
+    test_encode_row();
+    test_csv_header();
+    test_core_eager();
+    test_core_deferred();
+    test_core_buffer();
+    return test_result("key_core_test");
+}
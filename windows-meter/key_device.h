@@ -0,0 +1,102 @@
+// key_device.h
+// Keyboard identity for key_logger. The Device column holds a handle that is
+// only meaningful within one capture (RawInput HANDLE, evdev/hidraw node
+// number); the session header maps it to what identifies the hardware:
+// USB vendor/product ID, serial (or the OS instance ID when the device has
+// none), product name and interface path. The same identity is what an
+// allow-list (--device) is matched against, so only the device under test
+// is captured.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+struct KeyDeviceInfo {
+    uint64_t id = 0;            // value of the Device column
+    uint16_t vendor = 0;        // 0 if unknown
+    uint16_t product = 0;
+    std::string serial;         // USB serial / uniq / OS instance ID, may be empty
+    std::string name;           // product name, may be empty
+    std::string path;           // interface path (Windows), phys or node (Linux)
+};
+
+// Header values are space separated; keep them one token
+static inline std::string device_field(const std::string& s) {
+    std::string out = s.empty() ? "-" : s;
+    for (char& c : out) {
+        if (c == ' ' || c == '"' || c == ',' || c == '\n' || c == '\r') c = '_';
+    }
+    return out;
+}
+
+// "# device id=.. vid=046d pid=c31c serial=.. name=.. path=.. captured=0|1"
+static inline std::string format_device_line(const KeyDeviceInfo& d, bool captured) {
+    char ids[64];
+    std::snprintf(ids, sizeof(ids), "# device id=%llu vid=%04x pid=%04x",
+                  (unsigned long long)d.id, (unsigned)d.vendor, (unsigned)d.product);
+    return std::string(ids) +
+           " serial=" + device_field(d.serial) +
+           " name=" + device_field(d.name) +
+           " path=" + device_field(d.path) +
+           " captured=" + (captured ? "1" : "0");
+}
+
+// One --device entry: "vvvv:pppp[:serial]" (hex IDs) or else any text that
+// must appear in the name, path or serial.
+struct DeviceMatch {
+    bool ids = false;
+    uint16_t vendor = 0;
+    uint16_t product = 0;
+    std::string serial;         // with ids: must equal when given
+    std::string text;           // without ids
+};
+
+static inline DeviceMatch parse_device_match(const std::string& s) {
+    DeviceMatch m;
+    char* end = nullptr;
+    const unsigned long vid = std::strtoul(s.c_str(), &end, 16);
+    if (end == s.c_str() + 4 && *end == ':') {
+        const char* p = end + 1;
+        const unsigned long pid = std::strtoul(p, &end, 16);
+        if (end == p + 4 && (*end == '\0' || *end == ':')) {
+            m.ids = true;
+            m.vendor = (uint16_t)vid;
+            m.product = (uint16_t)pid;
+            if (*end == ':') m.serial = end + 1;
+            return m;
+        }
+    }
+    m.text = s;
+    return m;
+}
+
+class DeviceFilter {
+public:
+    void add(const std::string& spec) { matches_.push_back(parse_device_match(spec)); }
+    bool empty() const { return matches_.empty(); }
+
+    // Everything is allowed while the list is empty
+    bool allows(const KeyDeviceInfo& d) const {
+        if (matches_.empty()) return true;
+        for (const DeviceMatch& m : matches_) {
+            if (m.ids) {
+                if (m.vendor == d.vendor && m.product == d.product &&
+                    (m.serial.empty() || m.serial == d.serial)) {
+                    return true;
+                }
+            } else if (d.name.find(m.text) != std::string::npos ||
+                       d.path.find(m.text) != std::string::npos ||
+                       (!d.serial.empty() && d.serial.find(m.text) != std::string::npos)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::vector<DeviceMatch> matches_;
+};
@@ -1,204 +1,288 @@
+// key_logger.cpp
+// Logs keyboard edges into two CSV streams: raw (every edge, including
+// chatter) and filtered (one DOWN per press after debounce). Keys are
+// identified by scan code and by their HID keyboard usage (Usage column,
+// key_codes.h), which do not depend on the host's keyboard layout; names are
+// left to the tools reading the logs.
+//  - Windows: RawInput (WM_INPUT), stamped with QPC when the message arrives.
+//  - Linux:   evdev (/dev/input/event*). The clock is switched to
+//    CLOCK_MONOTONIC (EVIOCSCLOCKID), so the kernel's event timestamp is on
+//    the same clock as the receive time and as serial_logger's arrival_ns.
+//    Both are logged; their difference is the scheduling/dispatch delay.
+//    Keys are reported with their set 1 scan code (key_codes.h), the VKey
+//    column holds the evdev key code.
+//  - Linux, --hidraw: HID input reports straight from /dev/hidraw*, decoded
+//    into edges by hid_keyboard.h and stamped when read() returns, ahead of
+//    the input layer. The VKey column holds the HID usage. Every report is
+//    also written to keyboard_<stamp>_hid.txt, which can be replayed.
+// Build (MSVC):  cl /std:c++17 /O2 /EHsc key_logger.cpp user32.lib
+// Build (Linux): g++ -std=c++17 -O2 -Wall -pthread key_logger.cpp -o key_logger
+// Run (Windows): key_logger [--debounce SPEC] [--device MATCH ...]
+// Run (Linux):   key_logger [--debounce SPEC] [--device MATCH ...] [--hidraw]
+//                           [--rt[=PRIO]] [--cpu N] [--rt-compare SEC] [SOURCE ...]
+//   SPEC picks the debounce of the filtered log (debounce.h), e.g. eager:5
+//   (default), deferred:8 or integrator:5,0x39=12.
+//   MATCH limits the capture to the device under test: vvvv:pppp[:serial]
+//   (USB IDs in hex) or a fragment of its name or path (key_device.h). Every
+//   keyboard seen is listed with its identity in "# device" lines after the
+//   column header, whether it is captured or not.
+//   SOURCE is /dev/input/eventN, a file of recorded struct input_event
+//   records, or - for stdin (e.g. a pipe). Default: every evdev device with
+//   letter keys. Recorded streams are replayed with their own timestamps.
+//   With --hidraw: /dev/hidrawN or a recorded _hid.txt dump (or -); default
+//   every hidraw device whose descriptor has keyboard fields. hidraw devices
+//   are numbered 1000 + N in the Device column.
+//   --rt runs the capture thread as SCHED_FIFO PRIO (default 80) with all
+//   memory locked (realtime.h; needs CAP_SYS_NICE and a memlock limit, e.g.
+//   root), --cpu N (only with --rt) pins it to CPU N. --rt-compare SEC
+//   switches between normal and real-time mode every SEC seconds. For live
+//   evdev devices the receive delay (receive time - kernel time) is reported
+//   per mode at exit and in "# receive_delay" lines at the end of both logs.
+
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/hidraw.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <fstream>
-#include <unordered_map>
 #include <string>
 #include <vector>
-#include <new>
 
-static LARGE_INTEGER freq;
-
-// Two output streams
-static std::ofstream logFiltered;
-static std::ofstream logRaw;
-
-// Debounce window (ms): tune 2..10 depending on your hardware
-static const double DEBOUNCE_MS = 5.0;
-
-// Identify key by scan code + E0/E1 flags (more stable than VKey)
-static uint32_t MakeKeyId(const RAWKEYBOARD& rk) {
-    uint32_t e0 = (rk.Flags & RI_KEY_E0) ? 1u : 0u;
-    uint32_t e1 = (rk.Flags & RI_KEY_E1) ? 1u : 0u;
-    return (uint32_t)rk.MakeCode | (e0 << 16) | (e1 << 17);
-}
+#include "hid_keyboard.h"
+#include "host_clock.h"
+#include "key_codes.h"
+#include "key_core.h"
+#include "key_device.h"
+#include "line_splitter.h"
+#ifndef _WIN32
+#include "realtime.h"
+#endif
+
+// Debounce of the filtered stream (debounce.h), --debounce to change it.
+// Eager 2..10 ms suits most hardware; debounce_eval compares strategies
+// on a raw log.
+static const char* const kDefaultDebounce = "eager:5";
+static DebounceSpec debounceSpec;
+
+// Raw (every edge, including chatter) and filtered (one DOWN per press),
+// written by a background thread
+static KeyLogWriter logWriter;
+static std::string logPrefix;    // keyboard_<stamp>
 
 static std::string MakeTimestampPrefix() {
-    SYSTEMTIME st;
-    GetLocalTime(&st);
+    LocalTime lt = local_time_now();
     char buf[128];
-    sprintf_s(buf, "%04u%02u%02u_%02u%02u%02u",
-              st.wYear, st.wMonth, st.wDay,
-              st.wHour, st.wMinute, st.wSecond);
+    snprintf(buf, sizeof(buf), "%04u%02u%02u_%02u%02u%02u",
+             lt.year, lt.month, lt.day,
+             lt.hour, lt.minute, lt.second);
     return std::string(buf);
 }
 
-static inline uint64_t QpcNow() {
-    LARGE_INTEGER c;
-    QueryPerformanceCounter(&c);
-    return (uint64_t)c.QuadPart;
-}
+// Only keyboards matching one of these are captured (--device, key_device.h)
+static DeviceFilter deviceFilter;
 
-static inline uint64_t QpcToNs(uint64_t qpc) {
-    return (qpc * 1000000000ULL) / (uint64_t)freq.QuadPart;
+// Handles the options both backends take (--debounce SPEC, --device MATCH)
+// at argv[i]; false if argv[i] is something else
+static bool ParseCommonArg(int argc, char** argv, int& i, bool& ok) {
+    if (strcmp(argv[i], "--debounce") == 0) {
+        ok = i + 1 < argc && parse_debounce_spec(argv[++i], debounceSpec);
+        if (!ok) printf("Bad --debounce, expected <eager|deferred|integrator>:<ms>[,<key>=<ms>...]\n");
+        return true;
+    }
+    if (strcmp(argv[i], "--device") == 0) {
+        ok = i + 1 < argc;
+        if (ok) deviceFilter.add(argv[++i]);
+        else printf("--device needs vvvv:pppp[:serial] or a name/path fragment\n");
+        return true;
+    }
+    return false;
 }
 
-static inline double QpcDeltaMs(uint64_t now, uint64_t then) {
-    if (then == 0) return 1e9;
-    uint64_t dq = now - then;
-    return (1000.0 * (double)dq) / (double)freq.QuadPart;
+// Session header: one "# device" line per keyboard seen, captured or not
+static void NoteDevice(const KeyDeviceInfo& d, bool captured) {
+    const std::string line = format_device_line(d, captured);
+    logWriter.note(line);
+    printf("%s\n", line.c_str() + 2);
 }
 
-// ---- NEW: turn RAWKEYBOARD into a human-readable key name ----
-// Uses scan code + E0 flag -> GetKeyNameText (localized to current keyboard layout).
-static std::string HumanKeyNameFromRaw(const RAWKEYBOARD& rk) {
-    // lParam bits for GetKeyNameText:
-    // bits 16..23: scan code
-    // bit 24: extended key (E0)
-    // bit 25: "do not care" (some examples set this, not required)
-    LONG lparam = ((LONG)rk.MakeCode) << 16;
+// Opens both logs with their header; capture starts with logWriter.start()
+static bool OpenLogs() {
+    logPrefix = "keyboard_" + MakeTimestampPrefix();
+    std::string filteredName = logPrefix + "_filtered.csv";
+    std::string rawName      = logPrefix + "_raw.csv";
+
+    FILE* filtered = fopen(filteredName.c_str(), "w");
+    if (!filtered) {
+        printf("Failed to open filtered log file: %s\n", filteredName.c_str());
+        return false;
+    }
 
-    if (rk.Flags & RI_KEY_E0) {
-        lparam |= (1L << 24);
+    FILE* raw = fopen(rawName.c_str(), "w");
+    if (!raw) {
+        printf("Failed to open raw log file: %s\n", rawName.c_str());
+        fclose(filtered);
+        return false;
     }
-    // Note: RI_KEY_E1 is rare (Pause/Break, etc). GetKeyNameText handles most cases.
 
-    char name[128] = {0};
-    int n = GetKeyNameTextA(lparam, name, (int)sizeof(name));
-    if (n > 0) return std::string(name);
+    printf("Listening...\n");
+    printf("Filtered log: %s (debounce %s)\n", filteredName.c_str(),
+           format_debounce_spec(debounceSpec).c_str());
+    printf("Raw log:      %s (all events)\n", rawName.c_str());
+
+    logWriter.open(raw, filtered, debounceSpec);
+
+    // Pair wall clock and monotonic clock once per session
+    LocalTime lt = local_time_now();
+    char session[160];
+    snprintf(session, sizeof(session),
+             "# session wall=%04u-%02u-%02uT%02u:%02u:%02u.%03u mono_ns=%llu debounce=%s",
+             lt.year, lt.month, lt.day, lt.hour, lt.minute, lt.second, lt.millisecond,
+             (unsigned long long)mono_now_ns(), format_debounce_spec(debounceSpec).c_str());
+    logWriter.note(session);
+    return true;
+}
+
+static void CloseLogs() {
+    const uint64_t lost = logWriter.stop();
+    if (lost > 0) printf("%llu key events were not written (writer backlog)\n", (unsigned long long)lost);
+}
 
-    // Fallback: if GetKeyNameText fails, give something usable
-    char fallback[64];
-    sprintf_s(fallback, "VK_%u_SC_%u", (unsigned)rk.VKey, (unsigned)rk.MakeCode);
-    return std::string(fallback);
+#ifdef _WIN32
+
+// One keyboard RAWINPUT is a fixed size; read straight into this buffer
+static union {
+    RAWINPUT input;
+    BYTE bytes[sizeof(RAWINPUT) + 64];
+} rawBuf;
+
+// ---- Device identity ----
+// Interface path, e.g.
+// \\?\HID#VID_046D&PID_C31C&MI_00#7&2a5c1f3b&0&0000#{884b96c3-56ef-11d1-bc8c-00a0c91405dd}
+// VID/PID come from it; the part after the second '#' is the instance ID,
+// which stays the same for a device on the same port across reboots.
+static KeyDeviceInfo RawDeviceIdentity(HANDLE h) {
+    KeyDeviceInfo d;
+    d.id = (uint64_t)(uintptr_t)h;
+    UINT size = 0;
+    if (GetRawInputDeviceInfoA(h, RIDI_DEVICENAME, NULL, &size) != 0 || size == 0) return d;
+    std::vector<char> path(size + 1, '\0');
+    if (GetRawInputDeviceInfoA(h, RIDI_DEVICENAME, path.data(), &size) == (UINT)-1) return d;
+    d.path = path.data();
+
+    if (const char* v = strstr(d.path.c_str(), "VID_")) d.vendor = (uint16_t)strtoul(v + 4, NULL, 16);
+    if (const char* p = strstr(d.path.c_str(), "PID_")) d.product = (uint16_t)strtoul(p + 4, NULL, 16);
+    const size_t first = d.path.find('#');
+    const size_t second = first == std::string::npos ? first : d.path.find('#', first + 1);
+    if (second != std::string::npos) {
+        const size_t third = d.path.find('#', second + 1);
+        d.serial = d.path.substr(second + 1, third == std::string::npos ? std::string::npos : third - second - 1);
+    }
+    return d;
 }
 
-// ---- Debounce state (per device + key) ----
-struct KeyState {
-    bool down = false;
-    uint64_t last_accept_qpc = 0;
+struct RawDevice {
+    HANDLE handle;
+    bool captured;
 };
+static std::vector<RawDevice> rawDevices;     // message thread only
+static uint64_t ignoredEvents = 0;
+
+// Devices plugged in during the capture are looked up on their first event.
+// Input without a device (injected by software) has a NULL handle.
+static bool RawDeviceCaptured(HANDLE h) {
+    for (const RawDevice& d : rawDevices) {
+        if (d.handle == h) return d.captured;
+    }
+    const KeyDeviceInfo info = RawDeviceIdentity(h);
+    const bool captured = deviceFilter.allows(info);
+    rawDevices.push_back(RawDevice{ h, captured });
+    NoteDevice(info, captured);
+    return captured;
+}
 
-// Keyed by (device handle + keyId)
-static std::unordered_map<uint64_t, KeyState> state;
+static void EnumerateKeyboards() {
+    UINT count = 0;
+    if (GetRawInputDeviceList(NULL, &count, sizeof(RAWINPUTDEVICELIST)) != 0 || count == 0) return;
+    std::vector<RAWINPUTDEVICELIST> list(count);
+    count = GetRawInputDeviceList(list.data(), &count, sizeof(RAWINPUTDEVICELIST));
+    if (count == (UINT)-1) return;
+    for (UINT i = 0; i < count; i++) {
+        if (list[i].dwType == RIM_TYPEKEYBOARD) RawDeviceCaptured(list[i].hDevice);
+    }
+}
+
+static DWORD mainThreadId;
+static volatile LONG logsClosed = 0;
 
-// (device,key) -> 64-bit map key
-static inline uint64_t MakeStateKey(HANDLE hDevice, uint32_t keyId) {
-    uint64_t dev = (uint64_t)(uintptr_t)hDevice;
-    return (dev << 32) ^ (uint64_t)keyId;
+// Ctrl+C / console close: end the message loop and give it time to write
+// out what is queued before the process goes away
+static BOOL WINAPI OnConsoleCtrl(DWORD) {
+    PostThreadMessage(mainThreadId, WM_QUIT, 0, 0);
+    for (int waited = 0; waited < 3000 && !logsClosed; waited += 10) Sleep(10);
+    return TRUE;
 }
 
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
     if (uMsg == WM_INPUT) {
-        UINT dwSize = 0;
-        if (GetRawInputData((HRAWINPUT)lParam, RID_INPUT, NULL, &dwSize, sizeof(RAWINPUTHEADER)) != 0 || dwSize == 0)
-            return 0;
-
-        BYTE* lpb = new (std::nothrow) BYTE[dwSize];
-        if (!lpb) return 0;
+        const uint64_t host_ns = mono_now_ns();
 
-        UINT got = GetRawInputData((HRAWINPUT)lParam, RID_INPUT, lpb, &dwSize, sizeof(RAWINPUTHEADER));
-        if (got != dwSize) { delete[] lpb; return 0; }
+        UINT dwSize = sizeof(rawBuf);
+        UINT got = GetRawInputData((HRAWINPUT)lParam, RID_INPUT, rawBuf.bytes, &dwSize, sizeof(RAWINPUTHEADER));
+        if (got == (UINT)-1 || got < sizeof(RAWINPUTHEADER)) return 0;
 
-        RAWINPUT* raw = (RAWINPUT*)lpb;
+        const RAWINPUT* raw = &rawBuf.input;
 
         if (raw->header.dwType == RIM_TYPEKEYBOARD) {
-            const RAWKEYBOARD& rk = raw->data.keyboard;
-            const bool isBreak = (rk.Flags & RI_KEY_BREAK) != 0;
-
-            const uint32_t keyId = MakeKeyId(rk);
-            const int e0 = (rk.Flags & RI_KEY_E0) ? 1 : 0;
-            const int e1 = (rk.Flags & RI_KEY_E1) ? 1 : 0;
-
-            const char* edge = isBreak ? "UP" : "DOWN";
-
-            uint64_t nowQpc = QpcNow();
-            uint64_t t_ns = QpcToNs(nowQpc);
-
-            // ---- NEW: compute key name once per event ----
-            std::string keyName = HumanKeyNameFromRaw(rk);
-
-            // ---- RAW STREAM: log everything (including bounce/chatter) ----
-            // Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,KeyName
-            logRaw << (uintptr_t)raw->header.hDevice << ","
-                   << rk.VKey << ","
-                   << rk.MakeCode << ","
-                   << e0 << ","
-                   << e1 << ","
-                   << edge << ","
-                   << t_ns << ","
-                   << "\"" << keyName << "\""
-                   << "\n";
-            logRaw.flush();
-
-            // ---- FILTERED STREAM: only first DOWN, no UP ----
-            const uint64_t mapKey = MakeStateKey(raw->header.hDevice, keyId);
-            KeyState& ks = state[mapKey];
-
-            double sinceMs = QpcDeltaMs(nowQpc, ks.last_accept_qpc);
-
-            bool accepted = false;
-
-            if (!isBreak) { // DOWN only
-                if (!ks.down && sinceMs >= DEBOUNCE_MS) {
-                    ks.down = true;
-                    ks.last_accept_qpc = nowQpc;
-                    accepted = true;
-                }
-            } else {
-                // UP: update state but never log
-                ks.down = false;
-            }
-
-            if (accepted) {
-                logFiltered << (uintptr_t)raw->header.hDevice << ","
-                            << rk.VKey << ","
-                            << rk.MakeCode << ","
-                            << e0 << ","
-                            << e1 << ","
-                            << "DOWN" << ","
-                            << t_ns << ","
-                            << "\"" << keyName << "\""
-                            << "\n";
-                logFiltered.flush();
+            if (!RawDeviceCaptured(raw->header.hDevice)) {
+                ignoredEvents++;
+                return 0;
             }
+            const RAWKEYBOARD& rk = raw->data.keyboard;
 
+            KeyEvent k;
+            k.device = (uint64_t)(uintptr_t)raw->header.hDevice;
+            k.vkey = rk.VKey;
+            k.scan = rk.MakeCode;
+            k.e0 = (rk.Flags & RI_KEY_E0) ? 1 : 0;
+            k.e1 = (rk.Flags & RI_KEY_E1) ? 1 : 0;
+            k.is_break = (rk.Flags & RI_KEY_BREAK) != 0;
+            k.host_ns = host_ns;
+            k.kernel_ns = -1;
+            k.usage = scan_to_hid_usage(k.scan, k.e0, k.e1);
+            logWriter.push(k);
         }
-
-        delete[] lpb;
         return 0;
     }
 
     return DefWindowProc(hwnd, uMsg, wParam, lParam);
 }
 
-int main() {
-    QueryPerformanceFrequency(&freq);
-
-    std::string prefix = MakeTimestampPrefix();
-    std::string filteredName = "keyboard_" + prefix + "_filtered.csv";
-    std::string rawName      = "keyboard_" + prefix + "_raw.csv";
-
-    logFiltered.open(filteredName, std::ios::out | std::ios::trunc);
-    if (!logFiltered.is_open()) {
-        printf("Failed to open filtered log file: %s\n", filteredName.c_str());
-        return 1;
-    }
-
-    logRaw.open(rawName, std::ios::out | std::ios::trunc);
-    if (!logRaw.is_open()) {
-        printf("Failed to open raw log file: %s\n", rawName.c_str());
-        return 1;
+int main(int argc, char** argv) {
+    parse_debounce_spec(kDefaultDebounce, debounceSpec);
+    for (int i = 1; i < argc; i++) {
+        bool ok = true;
+        if (!ParseCommonArg(argc, argv, i, ok)) {
+            printf("Usage: key_logger [--debounce SPEC] [--device MATCH ...]\n");
+            return 1;
+        }
+        if (!ok) return 1;
     }
 
-    printf("Listening...\n");
-    printf("Filtered log: %s (debounce %.2f ms)\n", filteredName.c_str(), DEBOUNCE_MS);
-    printf("Raw log:      %s (all events)\n", rawName.c_str());
-
-    logFiltered << "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,KeyName\n";
-    logRaw      << "Device,VKey,ScanCode,E0,E1,Edge,HostTimestamp_ns,KeyName\n";
-    logFiltered.flush();
-    logRaw.flush();
+    if (!OpenLogs()) return 1;
+    EnumerateKeyboards();
+    logWriter.start(true);
 
     RAWINPUTDEVICE rid;
     rid.usUsagePage = 0x01;
@@ -218,13 +302,520 @@ int main() {
     rid.hwndTarget = hwnd;
     RegisterRawInputDevices(&rid, 1, sizeof(rid));
 
+    mainThreadId = GetCurrentThreadId();
+    SetConsoleCtrlHandler(OnConsoleCtrl, TRUE);
+
     MSG msg;
     while (GetMessage(&msg, NULL, 0, 0)) {
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
 
-    logFiltered.close();
-    logRaw.close();
+    CloseLogs();
+    if (ignoredEvents > 0) {
+        printf("%llu key events from other devices ignored\n", (unsigned long long)ignoredEvents);
+    }
+    logsClosed = 1;
+    return 0;
+}
+
+#else
+
+static volatile sig_atomic_t g_stop = 0;
+static void OnSignal(int) { g_stop = 1; }
+
+// HID report dump: "rdesc <device> <hex>" once per device, then
+// "<device> <arrival_ns> <hex>" per report
+static std::ofstream logHid;
+
+// --rt / --cpu / --rt-compare
+static RealtimeOptions rtOptions;
+static double rtCompareSec = 0.0;
+static RealtimeState rtState;
+
+// Receive delay of live evdev events, [0] normal, [1] real-time mode
+static DelayHistogram receiveDelay[2];
+
+enum SourceKind {
+    kSourceEvdev,     // evdev device or recorded input_event stream
+    kSourceHidraw,    // hidraw device
+    kSourceHidDump,   // recorded _hid.txt
+};
+
+struct DumpDevice {
+    uint64_t device;
+    HidKeyboard hid;
+};
+
+struct InputSource {
+    std::string path;
+    SourceKind kind = kSourceEvdev;
+    int fd = -1;
+    uint64_t device = 0;        // N of /dev/input/eventN, 1000 + N of hidrawN, else the argument index
+    bool live = false;          // evdev device with its clock switched to CLOCK_MONOTONIC
+    size_t pending = 0;         // bytes of a partial input_event from the last read
+    unsigned char buf[64 * sizeof(struct input_event)];
+    HidKeyboard hid;            // hidraw
+    LineSplitter lines{1 << 14}; // dump (an rdesc line is up to 8 KiB of hex)
+    std::vector<DumpDevice> dump_devices;
+};
+
+static bool HasBit(const unsigned long* bits, unsigned bit) {
+    const unsigned per = 8 * sizeof(unsigned long);
+    return (bits[bit / per] >> (bit % per)) & 1;
+}
+
+static bool IsKeyboard(int fd) {
+    unsigned long keys[(KEY_MAX + 8 * sizeof(unsigned long)) / (8 * sizeof(unsigned long))] = {0};
+    if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0) return false;
+    return HasBit(keys, KEY_A) && HasBit(keys, KEY_Z) && HasBit(keys, KEY_ENTER);
+}
+
+// Report descriptor of a hidraw device, empty if it cannot be read
+static std::vector<uint8_t> ReadReportDescriptor(int fd) {
+    int size = 0;
+    if (ioctl(fd, HIDIOCGRDESCSIZE, &size) < 0 || size <= 0) return {};
+    struct hidraw_report_descriptor rd;
+    memset(&rd, 0, sizeof(rd));
+    rd.size = (uint32_t)size;
+    if (ioctl(fd, HIDIOCGRDESC, &rd) < 0) return {};
+    return std::vector<uint8_t>(rd.value, rd.value + rd.size);
+}
+
+static void AppendHex(std::string& out, const uint8_t* p, size_t n) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < n; i++) {
+        out += digits[p[i] >> 4];
+        out += digits[p[i] & 15];
+    }
+}
+
+static size_t ParseHex(const char* s, size_t len, uint8_t* out, size_t cap) {
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    size_t n = 0;
+    for (size_t i = 0; i + 1 < len && n < cap; i += 2) {
+        const int hi = nibble(s[i]), lo = nibble(s[i + 1]);
+        if (hi < 0 || lo < 0) break;
+        out[n++] = (uint8_t)(hi << 4 | lo);
+    }
+    return n;
+}
+
+// Strings from EVIOCGNAME/HIDIOCGRAWPHYS and the like, empty if not supported
+static std::string IoctlString(int fd, unsigned long request) {
+    char buf[256] = {0};
+    if (ioctl(fd, request, buf) < 0) return std::string();
+    buf[sizeof(buf) - 1] = '\0';
+    return std::string(buf);
+}
+
+// path is the physical location (e.g. usb-0000:00:14.0-2/input0), stable
+// for a port, unlike the node number; serial is the device's uniq string
+static KeyDeviceInfo DeviceIdentity(const InputSource& src) {
+    KeyDeviceInfo d;
+    d.id = src.device;
+    d.path = src.path;
+    if (src.kind == kSourceEvdev) {
+        struct input_id id;
+        if (ioctl(src.fd, EVIOCGID, &id) == 0) {
+            d.vendor = id.vendor;
+            d.product = id.product;
+        }
+        d.name = IoctlString(src.fd, EVIOCGNAME(256));
+        d.serial = IoctlString(src.fd, EVIOCGUNIQ(256));
+        const std::string phys = IoctlString(src.fd, EVIOCGPHYS(256));
+        if (!phys.empty()) d.path = phys;
+    } else if (src.kind == kSourceHidraw) {
+        struct hidraw_devinfo info;
+        if (ioctl(src.fd, HIDIOCGRAWINFO, &info) == 0) {
+            d.vendor = (uint16_t)info.vendor;
+            d.product = (uint16_t)info.product;
+        }
+        d.name = IoctlString(src.fd, HIDIOCGRAWNAME(256));
+#ifdef HIDIOCGRAWUNIQ
+        d.serial = IoctlString(src.fd, HIDIOCGRAWUNIQ(256));
+#endif
+        const std::string phys = IoctlString(src.fd, HIDIOCGRAWPHYS(256));
+        if (!phys.empty()) d.path = phys;
+    }
+    return d;
+}
+
+// Opens a source before any log exists, so that a bad path leaves no files
+// behind; AttachSource() logs it once the logs are open
+static bool OpenSource(const std::string& path, SourceKind kind, uint64_t index, InputSource& src) {
+    src.path = path;
+    src.kind = kind;
+    src.device = index;
+    src.fd = path == "-" ? dup(STDIN_FILENO) : open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (src.fd < 0) {
+        printf("Failed to open %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    unsigned n;
+    if (kind == kSourceEvdev) {
+        int clk = CLOCK_MONOTONIC;
+        src.live = ioctl(src.fd, EVIOCSCLOCKID, &clk) == 0;
+        if (sscanf(path.c_str(), "/dev/input/event%u", &n) == 1) src.device = n;
+    } else if (kind == kSourceHidraw) {
+        if (sscanf(path.c_str(), "/dev/hidraw%u", &n) == 1) src.device = 1000 + n;
+    }
+    return true;
+}
+
+// Notes the source's identity in the logs; closes it (fd -1) if the device
+// is not on the --device list
+static void AttachSource(InputSource& src) {
+    const std::string& path = src.path;
+    // Recorded files carry no identity and are always replayed
+    const KeyDeviceInfo info = DeviceIdentity(src);
+    const bool captured = path.rfind("/dev/", 0) != 0 || deviceFilter.allows(info);
+    NoteDevice(info, captured);
+    if (!captured) {
+        close(src.fd);
+        src.fd = -1;
+        return;
+    }
+
+    if (src.kind == kSourceHidraw) {
+        const std::vector<uint8_t> rdesc = ReadReportDescriptor(src.fd);
+        if (rdesc.empty() || !src.hid.parse_descriptor(rdesc.data(), rdesc.size())) {
+            printf("%s: no keyboard fields in the report descriptor, assuming boot protocol\n",
+                   path.c_str());
+        }
+        if (!rdesc.empty()) {
+            std::string line = "rdesc " + std::to_string(src.device) + " ";
+            AppendHex(line, rdesc.data(), rdesc.size());
+            logHid << line << "\n";
+        }
+    }
+}
+
+static std::vector<std::string> FindDevices(const char* dirPath, const char* stem, bool hidraw) {
+    std::vector<std::string> found;
+    DIR* dir = opendir(dirPath);
+    if (!dir) return found;
+    while (struct dirent* de = readdir(dir)) {
+        if (strncmp(de->d_name, stem, strlen(stem)) != 0) continue;
+        std::string path = std::string(dirPath) + "/" + de->d_name;
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        bool keyboard;
+        if (hidraw) {
+            const std::vector<uint8_t> rdesc = ReadReportDescriptor(fd);
+            HidKeyboard probe;
+            keyboard = !rdesc.empty() && probe.parse_descriptor(rdesc.data(), rdesc.size());
+        } else {
+            keyboard = IsKeyboard(fd);
+        }
+        if (keyboard) found.push_back(path);
+        close(fd);
+    }
+    closedir(dir);
+    return found;
+}
+
+static void ReadEvdev(InputSource& src, size_t got, uint64_t host_ns) {
+    const size_t have = src.pending + got;
+    const size_t whole = have / sizeof(struct input_event);
+    for (size_t i = 0; i < whole; i++) {
+        struct input_event ev;
+        memcpy(&ev, src.buf + i * sizeof(ev), sizeof(ev));
+        if (ev.type != EV_KEY || ev.value < 0 || ev.value > 2) continue;
+
+        const ScanCode sc = evdev_to_scan(ev.code);
+        KeyEvent k;
+        k.device = src.device;
+        k.vkey = ev.code;
+        k.scan = sc.make;
+        k.e0 = sc.e0;
+        k.e1 = sc.e1;
+        k.is_break = ev.value == 0;     // 2 is autorepeat, logged as DOWN like RawInput
+        k.host_ns = host_ns;
+        k.kernel_ns = (int64_t)ev.input_event_sec * 1000000000LL +
+                      (int64_t)ev.input_event_usec * 1000LL;
+        k.usage = scan_to_hid_usage(sc.make, sc.e0, sc.e1);
+        if (src.live) receiveDelay[rtState.active ? 1 : 0].add((int64_t)host_ns - k.kernel_ns);
+        logWriter.push(k, !src.live);
+    }
+
+    src.pending = have - whole * sizeof(struct input_event);
+    if (src.pending > 0) memmove(src.buf, src.buf + whole * sizeof(struct input_event), src.pending);
+}
+
+static void DecodeReport(HidKeyboard& hid, uint64_t device, const uint8_t* report, size_t len,
+                         uint64_t arrival_ns, bool replay) {
+    hid.decode(report, len, [&](uint8_t usage, bool down) {
+        const ScanCode sc = hid_usage_to_scan(usage);
+        KeyEvent k;
+        k.device = device;
+        k.vkey = usage;
+        k.scan = sc.make;
+        k.e0 = sc.e0;
+        k.e1 = sc.e1;
+        k.is_break = !down;
+        k.host_ns = arrival_ns;
+        k.kernel_ns = -1;
+        k.usage = usage;
+        logWriter.push(k, replay);
+    });
+}
+
+// hidraw delivers exactly one report per read()
+static void ReadHidraw(InputSource& src, size_t got, uint64_t host_ns) {
+    static const char digits[] = "0123456789abcdef";
+    char line[48 + 2 * sizeof(src.buf)];
+    char* p = key_put_u64(line, src.device);
+    *p++ = ' ';
+    p = key_put_u64(p, host_ns);
+    *p++ = ' ';
+    for (size_t i = 0; i < got; i++) {
+        *p++ = digits[src.buf[i] >> 4];
+        *p++ = digits[src.buf[i] & 15];
+    }
+    *p++ = '\n';
+    logHid.write(line, p - line);
+    DecodeReport(src.hid, src.device, src.buf, got, host_ns, false);
+}
+
+static HidKeyboard& DumpDecoder(InputSource& src, uint64_t device) {
+    for (auto& d : src.dump_devices) {
+        if (d.device == device) return d.hid;
+    }
+    src.dump_devices.push_back(DumpDevice{ device, HidKeyboard() });
+    return src.dump_devices.back().hid;
+}
+
+static void ReplayDumpLine(InputSource& src, std::string_view line) {
+    uint8_t bytes[4096];
+    unsigned long long device = 0, arrival = 0;
+    int used = 0;
+    const std::string text(line);
+    if (sscanf(text.c_str(), "rdesc %llu %n", &device, &used) == 1 && used > 0) {
+        const size_t n = ParseHex(text.c_str() + used, text.size() - (size_t)used, bytes, sizeof(bytes));
+        if (!DumpDecoder(src, device).parse_descriptor(bytes, n)) {
+            printf("%s: device %llu has no keyboard fields, assuming boot protocol\n",
+                   src.path.c_str(), device);
+        }
+        return;
+    }
+    if (sscanf(text.c_str(), "%llu %llu %n", &device, &arrival, &used) == 2 && used > 0) {
+        const size_t n = ParseHex(text.c_str() + used, text.size() - (size_t)used, bytes, sizeof(bytes));
+        DecodeReport(DumpDecoder(src, device), device, bytes, n, arrival, true);
+    }
+}
+
+// Reads what is available; false at end of stream or on error
+static bool ReadSource(InputSource& src) {
+    void* dst = src.kind == kSourceHidDump ? (void*)src.lines.write_ptr() : (void*)(src.buf + src.pending);
+    const size_t room = src.kind == kSourceHidDump ? src.lines.write_space() : sizeof(src.buf) - src.pending;
+    ssize_t n = read(src.fd, dst, room);
+    const uint64_t host_ns = mono_now_ns();
+    if (n < 0) {
+        if (errno == EINTR || errno == EAGAIN) return true;
+        printf("Read failed on %s: %s\n", src.path.c_str(), strerror(errno));
+        return false;
+    }
+    if (n == 0) return false;
+
+    switch (src.kind) {
+    case kSourceEvdev:
+        ReadEvdev(src, (size_t)n, host_ns);
+        break;
+    case kSourceHidraw:
+        ReadHidraw(src, (size_t)n, host_ns);
+        break;
+    case kSourceHidDump:
+        src.lines.commit((size_t)n);
+        src.lines.drain([&](std::string_view line) { ReplayDumpLine(src, line); });
+        break;
+    }
+    return true;
+}
+
+static void ReportReceiveDelay() {
+    static const char* const kModes[2] = { "normal", "rt" };
+    for (int m = 0; m < 2; m++) {
+        if (receiveDelay[m].count() == 0) continue;
+        char stats[192];
+        receiveDelay[m].format(stats, sizeof(stats));
+        printf("Receive delay (%s): %s\n", kModes[m], stats);
+        logWriter.note(std::string("# receive_delay mode=") + kModes[m] + " " + stats);
+    }
+}
+
+static void PrintUsage() {
+    printf("Usage: key_logger [--debounce SPEC] [--device MATCH ...] [--hidraw]\n"
+           "                  [--rt[=PRIO]] [--cpu N] [--rt-compare SEC] [SOURCE ...]\n"
+           "  SOURCE: /dev/input/eventN, /dev/hidrawN, a recorded file or - for stdin\n");
+}
+
+int main(int argc, char** argv) {
+    bool hidraw = false;
+    std::vector<std::string> paths;
+    parse_debounce_spec(kDefaultDebounce, debounceSpec);
+    for (int i = 1; i < argc; i++) {
+        bool ok = true;
+        if (ParseCommonArg(argc, argv, i, ok)) {
+            if (!ok) return 1;
+        } else if (strcmp(argv[i], "--hidraw") == 0) {
+            hidraw = true;
+        } else if (strncmp(argv[i], "--rt", 4) == 0 && (argv[i][4] == '\0' || argv[i][4] == '=')) {
+            rtOptions.enabled = true;
+            char* end = argv[i] + 4;
+            if (*end == '=') rtOptions.priority = (int)strtol(argv[i] + 5, &end, 10);
+            if (*end != '\0' || rtOptions.priority < 1 || rtOptions.priority > 99) {
+                printf("--rt priority must be 1..99\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--cpu") == 0) {
+            char* end = nullptr;
+            const long cpu = i + 1 < argc ? strtol(argv[++i], &end, 10) : -1;
+            if (!end || *end != '\0' || end == argv[i] || cpu < 0 || cpu >= CPU_SETSIZE) {
+                printf("--cpu needs a CPU number\n");
+                return 1;
+            }
+            rtOptions.cpu = (int)cpu;
+        } else if (strcmp(argv[i], "--rt-compare") == 0) {
+            rtOptions.enabled = true;
+            char* end = nullptr;
+            rtCompareSec = i + 1 < argc ? strtod(argv[++i], &end) : 0.0;
+            if (!end || *end != '\0' || !(rtCompareSec > 0.0)) {
+                printf("--rt-compare needs a period in seconds\n");
+                return 1;
+            }
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            PrintUsage();
+            return 0;
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            printf("Unknown option %s\n", argv[i]);
+            PrintUsage();
+            return 1;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (rtOptions.cpu >= 0 && !rtOptions.enabled) {
+        printf("--cpu pins the real-time capture thread; use it with --rt or --rt-compare\n");
+        return 1;
+    }
+    if (paths.empty()) {
+        paths = hidraw ? FindDevices("/dev", "hidraw", true)
+                       : FindDevices("/dev/input", "event", false);
+    }
+    if (paths.empty()) {
+        printf("No keyboard found (permissions?). Pass a device or file.\n");
+        return 1;
+    }
+
+    std::vector<InputSource> sources(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        SourceKind kind = kSourceEvdev;
+        if (paths[i].rfind("/dev/hidraw", 0) == 0) kind = kSourceHidraw;
+        else if (hidraw) kind = kSourceHidDump;
+        if (!OpenSource(paths[i], kind, i, sources[i])) return 1;
+    }
+
+    if (!OpenLogs()) return 1;
+
+    bool attached = true;
+    for (auto& src : sources) {
+        if (src.kind == kSourceHidraw && !logHid.is_open()) {
+            const std::string hidName = logPrefix + "_hid.txt";
+            logHid.open(hidName, std::ios::out | std::ios::trunc);
+            if (!logHid.is_open()) {
+                printf("Failed to open HID report dump: %s\n", hidName.c_str());
+                attached = false;
+                break;
+            }
+            printf("HID dump:     %s\n", hidName.c_str());
+        }
+        AttachSource(src);
+        if (src.fd < 0) continue;
+        printf("Source %s (device %llu, %s)\n", src.path.c_str(),
+               (unsigned long long)src.device,
+               src.kind == kSourceHidraw ? "hidraw reports" :
+               src.kind == kSourceHidDump ? "recorded HID reports" :
+               src.live ? "kernel CLOCK_MONOTONIC" : "recorded stream");
+    }
+
+    size_t open_sources = 0;
+    bool liveClock = true;
+    for (const auto& src : sources) {
+        if (src.fd < 0) continue;
+        open_sources++;
+        // Devices stamp on CLOCK_MONOTONIC; files and pipes carry recorded times
+        liveClock &= src.path.rfind("/dev/", 0) == 0;
+    }
+    if (!attached || open_sources == 0) {
+        if (attached) printf("No keyboard matches --device.\n");
+        for (auto& src : sources) {
+            if (src.fd >= 0) close(src.fd);
+        }
+        CloseLogs();
+        return 1;
+    }
+    logWriter.start(liveClock);
+
+    // After start(), so the writer thread keeps the normal policy
+    uint64_t nextSwitch = UINT64_MAX;
+    if (rtOptions.enabled) {
+        std::string err;
+        if (enter_realtime(rtOptions, rtState, err)) {
+            printf("Real-time: SCHED_FIFO %d%s\n", rtOptions.priority,
+                   rtOptions.cpu >= 0 ? (", CPU " + std::to_string(rtOptions.cpu)).c_str() : "");
+            if (rtCompareSec > 0.0) nextSwitch = mono_now_ns() + (uint64_t)(rtCompareSec * 1e9);
+        } else {
+            printf("Real-time mode unavailable, capturing normally: %s\n", err.c_str());
+        }
+    }
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    std::vector<struct pollfd> pfds(sources.size());
+    while (!g_stop && open_sources > 0) {
+        for (size_t i = 0; i < sources.size(); i++) {
+            pfds[i].fd = sources[i].fd;
+            pfds[i].events = POLLIN;
+            pfds[i].revents = 0;
+        }
+        int rc = poll(pfds.data(), pfds.size(), 200);
+        if (rc < 0 && errno != EINTR) break;
+        if (nextSwitch != UINT64_MAX && mono_now_ns() >= nextSwitch) {
+            std::string err;
+            if (rtState.active) leave_realtime(rtState);
+            else if (!enter_realtime(rtOptions, rtState, err)) printf("Real-time mode lost: %s\n", err.c_str());
+            nextSwitch = mono_now_ns() + (uint64_t)(rtCompareSec * 1e9);
+        }
+        for (size_t i = 0; i < sources.size() && rc > 0; i++) {
+            if (!(pfds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            if (!ReadSource(sources[i])) {
+                if (sources[i].kind == kSourceHidDump) {
+                    std::string_view rest = sources[i].lines.remainder();
+                    if (!rest.empty()) ReplayDumpLine(sources[i], rest);
+                }
+                close(sources[i].fd);
+                sources[i].fd = -1;         // poll ignores negative fds
+                open_sources--;
+            }
+        }
+    }
+
+    for (auto& src : sources) {
+        if (src.fd >= 0) close(src.fd);
+    }
+    leave_realtime(rtState);
+    ReportReceiveDelay();
+    CloseLogs();
+    if (logHid.is_open()) logHid.close();
     return 0;
 }
+
+#endif
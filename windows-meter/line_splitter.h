@@ -0,0 +1,90 @@
+// line_splitter.h
+// Splits a byte stream into lines without per-line allocation.
+// Reads go straight into one preallocated buffer (write_ptr/commit); drain()
+// scans only the newly committed bytes with memchr and hands out
+// std::string_view lines with CR/LF stripped. The unfinished tail is moved to
+// the front once per drain, so work is linear in the bytes received.
+// drain_until() stops at a wanted line and keeps the rest buffered.
+// Views are valid until the next commit()/drain().
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+class LineSplitter {
+public:
+    explicit LineSplitter(size_t capacity = 1 << 16) : buf_(capacity) {}
+
+    char* write_ptr() { return buf_.data() + end_; }
+    size_t write_space() const { return buf_.size() - end_; }
+    void commit(size_t n) { end_ += n; }
+
+    // Calls fn(std::string_view) for every complete, non-empty line.
+    template <class Fn>
+    void drain(Fn&& fn) {
+        drain_until([&](std::string_view line) {
+            fn(line);
+            return false;
+        });
+    }
+
+    // Like drain(), but stops after the first line for which fn returns
+    // true; the lines after it stay buffered for the next drain. Returns
+    // whether fn stopped it.
+    template <class Fn>
+    bool drain_until(Fn&& fn) {
+        char* base = buf_.data();
+        size_t line_start = 0;
+        bool stopped = false;
+        while (scan_ < end_ && !stopped) {
+            const char* nl = (const char*)std::memchr(base + scan_, '\n', end_ - scan_);
+            if (!nl) {
+                scan_ = end_;
+                break;
+            }
+            const size_t pos = (size_t)(nl - base);
+            stopped = emit(base + line_start, pos - line_start, fn);
+            line_start = pos + 1;
+            scan_ = line_start;
+        }
+
+        // A line that fills the whole buffer can never complete; pass it on
+        // as is rather than stalling the stream
+        if (!stopped && line_start == 0 && end_ == buf_.size()) {
+            stopped = emit(base, end_, fn);
+            line_start = end_;
+            scan_ = end_;
+        }
+
+        if (line_start > 0) {
+            const size_t rest = end_ - line_start;
+            if (rest > 0) std::memmove(base, base + line_start, rest);
+            end_ = rest;
+            scan_ -= line_start;
+        }
+        return stopped;
+    }
+
+    // Unfinished last line (CR/LF stripped), e.g. at shutdown
+    std::string_view remainder() const { return trim(buf_.data(), end_); }
+    void clear() { end_ = scan_ = 0; }
+
+private:
+    static std::string_view trim(const char* p, size_t n) {
+        while (n > 0 && (p[n - 1] == '\r' || p[n - 1] == '\n')) n--;
+        return std::string_view(p, n);
+    }
+
+    template <class Fn>
+    static bool emit(const char* p, size_t n, Fn& fn) {
+        std::string_view line = trim(p, n);
+        return !line.empty() && fn(line);
+    }
+
+    std::vector<char> buf_;
+    size_t end_ = 0;    // bytes held
+    size_t scan_ = 0;   // bytes already searched for '\n'
+};
@@ -0,0 +1,135 @@
+// live_stats.h
+// Online statistics for one Pico clock segment, O(1) per event.
+// Intervals come from the Pico's own us counter, so host scheduling does not
+// enter them. Kept for the whole device (the actuation cadence) and per GPIO;
+// the status line shows the per-GPIO rates of its window.
+// A gap is an interval more than kGapFactor times the running mean, counted
+// once the mean has settled (kGapMinSamples).
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+// Welford mean/variance plus min/max
+struct RunningStats {
+    uint64_t n = 0;
+    double mean = 0;
+    double m2 = 0;
+    double min = 0;
+    double max = 0;
+
+    void add(double x) {
+        n++;
+        if (n == 1) {
+            min = max = x;
+        } else {
+            if (x < min) min = x;
+            if (x > max) max = x;
+        }
+        const double d = x - mean;
+        mean += d / (double)n;
+        m2 += d * (x - mean);
+    }
+
+    double stddev() const { return n > 1 ? std::sqrt(m2 / (double)(n - 1)) : 0.0; }
+};
+
+struct IntervalStats {
+    long long last_us = -1;
+    RunningStats interval;
+    uint64_t events = 0;
+    uint64_t window_events = 0;   // since the last status line
+    uint64_t gaps = 0;
+};
+
+class LiveStats {
+public:
+    static constexpr int kMaxGpio = 64;
+    static constexpr double kGapFactor = 1.5;
+    static constexpr uint64_t kGapMinSamples = 8;
+
+    void reset() { *this = LiveStats(); }
+
+    void on_event(int gpio, long long us) {
+        add(all_, us);
+        if (gpio >= 0 && gpio < kMaxGpio) add(gpio_[gpio], us);
+    }
+
+    // Heartbeat carries the Pico's cumulative drop counter
+    void on_heartbeat(long long dropped) {
+        if (dropped < 0) return;
+        if (last_dropped_ >= 0 && dropped >= last_dropped_) {
+            window_dropped_ += (uint64_t)(dropped - last_dropped_);
+            total_dropped_ += (uint64_t)(dropped - last_dropped_);
+        }
+        last_dropped_ = dropped;
+    }
+
+    // One line, then starts a new rate window
+    int format_status(char* buf, size_t size, double window_s) {
+        int worst = -1;
+        for (int g = 0; g < kMaxGpio; g++) {
+            if (gpio_[g].interval.n < 2) continue;
+            if (worst < 0 || gpio_[g].interval.stddev() > gpio_[worst].interval.stddev()) worst = g;
+        }
+
+        const RunningStats& iv = all_.interval;
+        int n = std::snprintf(buf, size,
+            "%6.1f ev/s | dt %.1f +- %.1f us [%.0f, %.0f] | gaps %llu | drop +%llu",
+            window_s > 0 ? (double)all_.window_events / window_s : 0.0,
+            iv.mean, iv.stddev(), iv.min, iv.max,
+            (unsigned long long)all_.gaps, (unsigned long long)window_dropped_);
+        if (worst >= 0 && n > 0 && (size_t)n < size) {
+            n += std::snprintf(buf + n, size - (size_t)n, " | worst GPIO%d sd %.1f us",
+                               worst, gpio_[worst].interval.stddev());
+        }
+        // Per-GPIO rates, " | GPIO ev/s 0:28.6 7:28.6"; a pin that stops
+        // firing drops out of the list
+        const char* label = " | GPIO ev/s";
+        for (int g = 0; g < kMaxGpio && window_s > 0; g++) {
+            if (gpio_[g].window_events == 0 || n <= 0 || (size_t)n >= size) continue;
+            n += std::snprintf(buf + n, size - (size_t)n, "%s %d:%.1f", label, g,
+                               (double)gpio_[g].window_events / window_s);
+            label = "";
+        }
+
+        all_.window_events = 0;
+        for (auto& g : gpio_) g.window_events = 0;
+        window_dropped_ = 0;
+        return n;
+    }
+
+    // Per-GPIO table for the end of a run
+    void print_summary(std::FILE* f, const char* device, unsigned segment) const {
+        std::fprintf(f, "%s segment %u: %llu events, %llu gaps, %llu dropped on the Pico\n",
+                     device, segment, (unsigned long long)all_.events,
+                     (unsigned long long)all_.gaps, (unsigned long long)total_dropped_);
+        for (int g = 0; g < kMaxGpio; g++) {
+            const IntervalStats& s = gpio_[g];
+            if (s.events == 0) continue;
+            std::fprintf(f, "  GPIO%-2d %8llu ev  dt %10.1f +- %7.1f us  [%.0f, %.0f]  gaps %llu\n",
+                         g, (unsigned long long)s.events, s.interval.mean, s.interval.stddev(),
+                         s.interval.min, s.interval.max, (unsigned long long)s.gaps);
+        }
+    }
+
+private:
+    static void add(IntervalStats& s, long long us) {
+        s.events++;
+        s.window_events++;
+        if (s.last_us >= 0 && us >= s.last_us) {
+            const double dt = (double)(us - s.last_us);
+            if (s.interval.n >= kGapMinSamples && dt > kGapFactor * s.interval.mean) s.gaps++;
+            s.interval.add(dt);
+        }
+        s.last_us = us;
+    }
+
+    IntervalStats all_;
+    IntervalStats gpio_[kMaxGpio];
+    long long last_dropped_ = -1;
+    uint64_t window_dropped_ = 0;
+    uint64_t total_dropped_ = 0;
+};
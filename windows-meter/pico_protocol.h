@@ -0,0 +1,219 @@
+// pico_protocol.h
+// Parser for the Pico firmware's text protocol (pico/main.c). Each line is
+// turned into a typed record once, so the CSV carries numeric columns and
+// nothing downstream has to re-parse "10037126 us GPIO0".
+//
+//   <us> us GPIO<n>                 DATA       us, gpio
+//   Heartbeat. Dropped=<n>          HEARTBEAT  dropped
+//   Load core=<n> total=.. ...      LOAD       text
+//   Batch=<seq> Board=<id>          BATCH      seq, board
+//   Board=<id>                      BOARD      board
+//   Calibration ppb=<n> | none      CAL        ppb (if present), text
+//   Sync=<us>                       SYNC       us
+//   Hello proto=<n> enc=<e> ...     HELLO      proto, encoding, board, text
+//   anything else                   INFO       text
+//
+// Hello is the firmware's self-description (version, encoding, pin map,
+// timing). select_decoder() maps it to the parser for the rest of the stream;
+// firmware without a hello is read with parse_line as before.
+//
+// Views in a Record point into the parsed line. pico_protocol_test.cpp
+// covers every line kind.
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+enum class LineType : uint8_t {
+    Data, Heartbeat, Load, Batch, Board, Cal, Sync, Info, Hello
+};
+
+// Highest protocol version this host can decode
+constexpr int kProtocolVersion = 1;
+
+static inline const char* line_type_name(LineType t) {
+    switch (t) {
+    case LineType::Data:      return "DATA";
+    case LineType::Heartbeat: return "HEARTBEAT";
+    case LineType::Load:      return "LOAD";
+    case LineType::Batch:     return "BATCH";
+    case LineType::Board:     return "BOARD";
+    case LineType::Cal:       return "CAL";
+    case LineType::Sync:      return "SYNC";
+    case LineType::Info:      return "INFO";
+    case LineType::Hello:     return "HELLO";
+    }
+    return "INFO";
+}
+
+struct Record {
+    LineType type = LineType::Info;
+    long long us = -1;          // DATA, SYNC
+    int gpio = -1;              // DATA
+    long long dropped = -1;     // HEARTBEAT
+    long long seq = -1;         // BATCH
+    long long ppb = 0;          // CAL
+    bool has_ppb = false;       // CAL
+    int proto = -1;             // HELLO
+    std::string_view encoding;  // HELLO
+    std::string_view board;     // BATCH, BOARD, HELLO
+    std::string_view text;      // set whenever the line was not fully parsed
+};
+
+static inline bool has_prefix(std::string_view s, std::string_view prefix) {
+    return s.size() >= prefix.size() && s.compare(0, prefix.size(), prefix) == 0;
+}
+
+static inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+// Unsigned decimal at s[i], advances i. False if there is no digit.
+static inline bool parse_uint(std::string_view s, size_t& i, long long& out) {
+    const size_t start = i;
+    long long v = 0;
+    while (i < s.size() && is_digit(s[i]) && i - start < 18) {
+        v = v * 10 + (s[i] - '0');
+        i++;
+    }
+    if (i == start || (i < s.size() && is_digit(s[i]))) return false;
+    out = v;
+    return true;
+}
+
+static inline bool parse_int(std::string_view s, size_t& i, long long& out) {
+    const bool neg = i < s.size() && s[i] == '-';
+    if (neg) i++;
+    if (!parse_uint(s, i, out)) return false;
+    if (neg) out = -out;
+    return true;
+}
+
+// Board ID from "Board=<id>" anywhere in the line, empty if absent
+static inline std::string_view extract_board_id(std::string_view line) {
+    size_t pos = line.find("Board=");
+    if (pos == std::string_view::npos) return std::string_view();
+    pos += 6;
+    size_t end = pos;
+    while (end < line.size() &&
+           (is_digit(line[end]) || (line[end] >= 'A' && line[end] <= 'F') ||
+            (line[end] >= 'a' && line[end] <= 'f'))) {
+        end++;
+    }
+    return line.substr(pos, end - pos);
+}
+
+// Value of " key=value" in a space-separated line, empty if absent
+static inline std::string_view field_value(std::string_view line, std::string_view key) {
+    size_t pos = 0;
+    while ((pos = line.find(key, pos)) != std::string_view::npos) {
+        const size_t start = pos + key.size();
+        if ((pos == 0 || line[pos - 1] == ' ') && start < line.size() && line[start] == '=') {
+            const size_t end = line.find(' ', start);
+            return line.substr(start + 1, (end == std::string_view::npos ? line.size() : end) - start - 1);
+        }
+        pos = start;
+    }
+    return std::string_view();
+}
+
+static inline Record parse_line(std::string_view line) {
+    Record r;
+    size_t i = 0;
+
+    if (has_prefix(line, "Heartbeat.")) {
+        r.type = LineType::Heartbeat;
+        i = line.find("Dropped=");
+        if (i != std::string_view::npos) {
+            i += 8;
+            if (parse_uint(line, i, r.dropped) && i == line.size()) return r;
+        }
+        r.text = line;
+        return r;
+    }
+    if (has_prefix(line, "Load core=")) {
+        r.type = LineType::Load;
+        r.text = line;
+        return r;
+    }
+    if (has_prefix(line, "Batch=")) {
+        r.type = LineType::Batch;
+        i = 6;
+        parse_uint(line, i, r.seq);
+        r.board = extract_board_id(line);
+        return r;
+    }
+    if (has_prefix(line, "Board=")) {
+        r.type = LineType::Board;
+        r.board = extract_board_id(line);
+        return r;
+    }
+    if (has_prefix(line, "Calibration ")) {
+        r.type = LineType::Cal;
+        i = 12;
+        if (has_prefix(line.substr(i), "ppb=")) {
+            i += 4;
+            r.has_ppb = parse_int(line, i, r.ppb);
+        }
+        r.text = line;
+        return r;
+    }
+    if (has_prefix(line, "Hello ")) {
+        r.type = LineType::Hello;
+        const std::string_view proto = field_value(line, "proto");
+        long long v;
+        size_t j = 0;
+        if (parse_uint(proto, j, v) && j == proto.size()) r.proto = (int)v;
+        r.encoding = field_value(line, "enc");
+        r.board = field_value(line, "board");
+        r.text = line;
+        return r;
+    }
+    if (has_prefix(line, "Sync=")) {
+        r.type = LineType::Sync;
+        i = 5;
+        if (parse_uint(line, i, r.us)) return r;
+        r.type = LineType::Info;
+        r.text = line;
+        return r;
+    }
+
+    // "<us> us" with optional " GPIO<n>"; leading spaces allowed
+    while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) i++;
+    long long us;
+    if (parse_uint(line, i, us)) {
+        while (i < line.size() && line[i] == ' ') i++;
+        if (has_prefix(line.substr(i), "us")) {
+            r.type = LineType::Data;
+            r.us = us;
+            i += 2;
+            long long gpio;
+            if (has_prefix(line.substr(i), " GPIO")) {
+                i += 5;
+                if (parse_uint(line, i, gpio) && gpio < 64) r.gpio = (int)gpio;
+            }
+            if (r.gpio < 0 || i != line.size()) r.text = line;  // keep anything unexpected
+            return r;
+        }
+    }
+
+    r.type = LineType::Info;
+    r.text = line;
+    return r;
+}
+
+typedef Record (*LineDecoder)(std::string_view line);
+
+// For streams this host cannot decode: every line is kept as text, only a new
+// hello is still recognised
+static inline Record parse_raw(std::string_view line) {
+    if (has_prefix(line, "Hello ")) return parse_line(line);
+    Record r;
+    r.text = line;
+    return r;
+}
+
+// Decoder for what a hello announced, nullptr if this host does not know it
+static inline LineDecoder select_decoder(int proto, std::string_view encoding) {
+    if (proto >= 1 && proto <= kProtocolVersion && encoding == "text") return parse_line;
+    return nullptr;
+}
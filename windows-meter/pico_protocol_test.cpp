@@ -0,0 +1,167 @@
+// pico_protocol_test.cpp
+// Checks the host-side parser of the Pico's text protocol (pico_protocol.h):
+// every line kind pico/main.c sends, truncated and garbled variants of them
+// (a line cut by a lost chunk, trailing junk, out-of-range numbers), the
+// raw decoder for unknown firmware and the decoder chosen from a hello.
+//
+// Build (MSVC):  cl /std:c++17 /O2 /EHsc pico_protocol_test.cpp
+// Build (Linux): g++ -std=c++17 -O2 -Wall pico_protocol_test.cpp -o pico_protocol_test
+// Run: pico_protocol_test   (exit code 0 when every check passes)
+
+#include "pico_protocol.h"
+#include "test_check.h"
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+static std::string str(std::string_view v) { return std::string(v); }
+
+static void test_data() {
+    Record r = parse_line("10037126 us GPIO0");
+    CHECK(r.type == LineType::Data, "type %s", line_type_name(r.type));
+    CHECK(r.us == 10037126 && r.gpio == 0, "us=%lld gpio=%d", r.us, r.gpio);
+    CHECK(r.text.empty(), "text \"%s\" on a complete line", str(r.text).c_str());
+
+    r = parse_line("  4294967296123 us GPIO16");
+    CHECK(r.type == LineType::Data && r.us == 4294967296123LL && r.gpio == 16 && r.text.empty(),
+          "leading spaces, 64-bit us: us=%lld gpio=%d", r.us, r.gpio);
+
+    // Old firmware: timestamp only
+    r = parse_line("10037126 us");
+    CHECK(r.type == LineType::Data && r.us == 10037126 && r.gpio == -1, "gpio=%d", r.gpio);
+    CHECK(r.text == "10037126 us", "a line without GPIO keeps its text");
+}
+
+// A chunk lost in the host ring or on USB cuts a line anywhere; the parts
+// must never turn into a plausible event on the wrong pin
+static void test_data_truncated() {
+    const char* const cut[] = { "10037126 us GPIO", "10037126 us GP", "10037126 us " };
+    for (const char* line : cut) {
+        const Record r = parse_line(line);
+        CHECK(r.type == LineType::Data && r.gpio == -1 && r.text == line, "\"%s\": type %s gpio=%d",
+              line, line_type_name(r.type), r.gpio);
+    }
+    const char* const not_data[] = { "1003712", "10037126 u", "us GPIO3", "GPIO3", "" };
+    for (const char* line : not_data) {
+        const Record r = parse_line(line);
+        CHECK(r.type == LineType::Info && r.text == line, "\"%s\": type %s", line, line_type_name(r.type));
+    }
+}
+
+static void test_data_garbled() {
+    Record r = parse_line("10037126 us GPIO3x");
+    CHECK(r.type == LineType::Data && !r.text.empty(), "trailing junk kept: text \"%s\"", str(r.text).c_str());
+    r = parse_line("10037126 us GPIO64");
+    CHECK(r.gpio == -1 && !r.text.empty(), "GPIO64 is out of range, gpio=%d", r.gpio);
+    r = parse_line("10037126 us GPIO99999999999999999999");
+    CHECK(r.gpio == -1 && !r.text.empty(), "overlong gpio, gpio=%d", r.gpio);
+    // More than 18 digits does not fit the parser's range: not a timestamp
+    r = parse_line("1234567890123456789 us GPIO1");
+    CHECK(r.type == LineType::Info, "19-digit us: type %s", line_type_name(r.type));
+    // Two lines run together by a lost line end
+    r = parse_line("10037126 us GPIO110072124 us GPIO1");
+    CHECK(r.type == LineType::Data && !r.text.empty(), "merged lines: gpio=%d text \"%s\"", r.gpio,
+          str(r.text).c_str());
+}
+
+static void test_heartbeat() {
+    Record r = parse_line("Heartbeat. Dropped=42");
+    CHECK(r.type == LineType::Heartbeat && r.dropped == 42 && r.text.empty(), "dropped=%lld", r.dropped);
+    r = parse_line("Heartbeat. Dropped=");
+    CHECK(r.type == LineType::Heartbeat && r.dropped == -1 && !r.text.empty(), "truncated: dropped=%lld",
+          r.dropped);
+    r = parse_line("Heartbeat. Dropped=4x");
+    CHECK(r.type == LineType::Heartbeat && !r.text.empty(), "garbled heartbeat keeps its text");
+    r = parse_line("Heartbeat.");
+    CHECK(r.type == LineType::Heartbeat && r.dropped == -1 && r.text == "Heartbeat.", "dropped=%lld",
+          r.dropped);
+}
+
+static void test_header_lines() {
+    const char load[] = "Load core=0 total=125000000 sched=41250 drain=183420 usb=2210344 hb=1896"
+                        " cmd=412 idle=122562682 max_loop=20344 long=0";
+    Record r = parse_line(load);
+    CHECK(r.type == LineType::Load && r.text == load, "type %s", line_type_name(r.type));
+
+    r = parse_line("Batch=17 Board=E6605838833C2A2F");
+    CHECK(r.type == LineType::Batch && r.seq == 17 && r.board == "E6605838833C2A2F", "seq=%lld board=%s",
+          r.seq, str(r.board).c_str());
+    r = parse_line("Batch= Board=E660");
+    CHECK(r.type == LineType::Batch && r.seq == -1 && r.board == "E660", "garbled seq=%lld", r.seq);
+    r = parse_line("Batch=3");
+    CHECK(r.type == LineType::Batch && r.seq == 3 && r.board.empty(), "cut before Board: board=%s",
+          str(r.board).c_str());
+
+    r = parse_line("Board=e6605838833c2a2f");
+    CHECK(r.type == LineType::Board && r.board == "e6605838833c2a2f", "board=%s", str(r.board).c_str());
+    r = parse_line("Board=XYZ");
+    CHECK(r.type == LineType::Board && r.board.empty(), "non-hex board=%s", str(r.board).c_str());
+    CHECK(extract_board_id("Batch=0 Board=E660 ") == "E660", "board ID ends at the first non-hex");
+
+    r = parse_line("Calibration ppb=-1234");
+    CHECK(r.type == LineType::Cal && r.has_ppb && r.ppb == -1234, "ppb=%lld", r.ppb);
+    r = parse_line("Calibration ppb=5678");
+    CHECK(r.type == LineType::Cal && r.has_ppb && r.ppb == 5678, "ppb=%lld", r.ppb);
+    r = parse_line("Calibration none");
+    CHECK(r.type == LineType::Cal && !r.has_ppb && r.text == "Calibration none", "none");
+    r = parse_line("Calibration failed");
+    CHECK(r.type == LineType::Cal && !r.has_ppb, "failed");
+    r = parse_line("Calibration ppb=");
+    CHECK(r.type == LineType::Cal && !r.has_ppb, "truncated ppb");
+
+    r = parse_line("Sync=123456789");
+    CHECK(r.type == LineType::Sync && r.us == 123456789, "us=%lld", r.us);
+    r = parse_line("Sync=");
+    CHECK(r.type == LineType::Info && r.text == "Sync=", "truncated sync: type %s", line_type_name(r.type));
+
+    r = parse_line("Pico multi-GPIO actuator started. Interval=35 ms, duration=5 ms");
+    CHECK(r.type == LineType::Info && !r.text.empty(), "banner: type %s", line_type_name(r.type));
+}
+
+static void test_hello() {
+    const char hello[] = "Hello proto=1 enc=text fw=multi-gpio-actuator board=E6605838833C2A2F"
+                         " pins=0,1,2,3,4,5,10,11,12,13,14,15,16 interval_ms=35 pulse_ms=5 queue=128 clock=us";
+    Record r = parse_line(hello);
+    CHECK(r.type == LineType::Hello && r.proto == 1, "proto=%d", r.proto);
+    CHECK(r.encoding == "text" && r.board == "E6605838833C2A2F", "enc=%s board=%s",
+          str(r.encoding).c_str(), str(r.board).c_str());
+    CHECK(r.text == hello, "hello keeps the whole line for the session metadata");
+    CHECK(field_value(hello, "pins") == "0,1,2,3,4,5,10,11,12,13,14,15,16", "pins");
+    CHECK(field_value(hello, "clock") == "us", "last field");
+    CHECK(field_value("Hello xproto=3 proto=2", "proto") == "2", "key must start a word");
+    CHECK(field_value("Hello proto", "proto").empty(), "key without a value");
+
+    r = parse_line("Hello proto=x enc=text");
+    CHECK(r.type == LineType::Hello && r.proto == -1, "garbled proto=%d", r.proto);
+    r = parse_line("Hello proto=1");
+    CHECK(r.type == LineType::Hello && r.proto == 1 && r.encoding.empty(), "cut after proto");
+}
+
+static void test_decoders() {
+    CHECK(select_decoder(1, "text") == parse_line, "proto 1 text");
+    CHECK(select_decoder(kProtocolVersion + 1, "text") == nullptr, "newer protocol");
+    CHECK(select_decoder(0, "text") == nullptr, "proto 0");
+    CHECK(select_decoder(-1, "text") == nullptr, "no proto");
+    CHECK(select_decoder(1, "bin") == nullptr, "binary encoding");
+    CHECK(select_decoder(1, "") == nullptr, "no encoding");
+
+    // Unknown firmware: nothing is interpreted, only a new hello
+    Record r = parse_raw("10037126 us GPIO0");
+    CHECK(r.type == LineType::Info && r.text == "10037126 us GPIO0" && r.us == -1, "raw data line");
+    r = parse_raw("Heartbeat. Dropped=1");
+    CHECK(r.type == LineType::Info && r.dropped == -1, "raw heartbeat");
+    r = parse_raw("Hello proto=1 enc=text board=E660");
+    CHECK(r.type == LineType::Hello && r.proto == 1 && r.board == "E660", "hello in a raw stream");
+}
+
+int main() {
+    test_data();
+    test_data_truncated();
+    test_data_garbled();
+    test_heartbeat();
+    test_header_lines();
+    test_hello();
+    test_decoders();
+    return test_result("pico_protocol_test");
+}
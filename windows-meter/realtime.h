@@ -0,0 +1,140 @@
+// realtime.h
+// Opt-in real-time mode for a capture thread (Linux): SCHED_FIFO priority,
+// pinning to one CPU, mlockall() and a pre-faulted stack, so that page
+// faults and the scheduler stay out of the receive timestamps. leave_realtime()
+// undoes it, which lets a capture alternate between both modes.
+//
+// DelayHistogram collects receive delays (userspace receive time minus the
+// kernel's event time) at O(1) per event, to show how much of the measured
+// latency is the measuring host itself.
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+struct RealtimeOptions {
+    bool enabled = false;
+    int priority = 80;      // SCHED_FIFO 1..99
+    int cpu = -1;           // -1: no pinning
+};
+
+#ifdef __linux__
+
+// Touches the stack the capture thread may need, so it is resident before
+// it is locked
+static inline void prefault_stack() {
+    volatile char stack[256 * 1024];
+    for (size_t i = 0; i < sizeof(stack); i += 4096) stack[i] = 0;
+}
+
+struct RealtimeState {
+    bool active = false;
+    cpu_set_t saved_cpus;
+    bool saved_cpus_valid = false;
+};
+
+// Applies to the calling thread (and memory of the whole process). On
+// failure nothing stays changed and err says why (usually missing
+// CAP_SYS_NICE / RLIMIT_RTPRIO or RLIMIT_MEMLOCK).
+static inline bool enter_realtime(const RealtimeOptions& opt, RealtimeState& st, std::string& err) {
+    st.saved_cpus_valid = sched_getaffinity(0, sizeof(st.saved_cpus), &st.saved_cpus) == 0;
+
+    if (opt.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(opt.cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            err = std::string("sched_setaffinity: ") + std::strerror(errno);
+            return false;
+        }
+    }
+
+    prefault_stack();
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        err = std::string("mlockall: ") + std::strerror(errno);
+        if (st.saved_cpus_valid) sched_setaffinity(0, sizeof(st.saved_cpus), &st.saved_cpus);
+        return false;
+    }
+
+    struct sched_param sp;
+    std::memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = opt.priority;
+    if (sched_setscheduler(0, SCHED_FIFO, &sp) != 0) {
+        err = std::string("sched_setscheduler(SCHED_FIFO): ") + std::strerror(errno);
+        munlockall();
+        if (st.saved_cpus_valid) sched_setaffinity(0, sizeof(st.saved_cpus), &st.saved_cpus);
+        return false;
+    }
+    st.active = true;
+    return true;
+}
+
+static inline void leave_realtime(RealtimeState& st) {
+    if (!st.active) return;
+    struct sched_param sp;
+    std::memset(&sp, 0, sizeof(sp));
+    sched_setscheduler(0, SCHED_OTHER, &sp);
+    munlockall();
+    if (st.saved_cpus_valid) sched_setaffinity(0, sizeof(st.saved_cpus), &st.saved_cpus);
+    st.active = false;
+}
+
+#endif
+
+// 1 us buckets up to kBuckets us, everything above in one overflow bucket
+// (its exact maximum is kept)
+class DelayHistogram {
+public:
+    static constexpr uint32_t kBuckets = 8192;
+
+    void add(int64_t delay_ns) {
+        if (delay_ns < 0) {
+            negative_++;        // clocks disagree; not a delay
+            return;
+        }
+        const uint64_t us = (uint64_t)delay_ns / 1000;
+        bins_[us < kBuckets ? us : kBuckets]++;
+        n_++;
+        sum_ns_ += (uint64_t)delay_ns;
+        if ((uint64_t)delay_ns > max_ns_) max_ns_ = (uint64_t)delay_ns;
+    }
+
+    uint64_t count() const { return n_; }
+
+    // Upper edge of the bucket holding quantile q, in us
+    double quantile_us(double q) const {
+        if (n_ == 0) return 0.0;
+        const uint64_t rank = (uint64_t)(q * (double)(n_ - 1));
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i <= kBuckets; i++) {
+            seen += bins_[i];
+            if (seen > rank) return i < kBuckets ? (double)(i + 1) : (double)max_ns_ * 1e-3;
+        }
+        return (double)max_ns_ * 1e-3;
+    }
+
+    // "n=.. mean_us=.. p50_us=.. p99_us=.. p999_us=.. max_us=.."
+    int format(char* buf, size_t size) const {
+        return std::snprintf(buf, size,
+            "n=%llu mean_us=%.1f p50_us=%.0f p99_us=%.0f p999_us=%.0f max_us=%.1f negative=%llu",
+            (unsigned long long)n_, n_ ? (double)sum_ns_ / (double)n_ * 1e-3 : 0.0,
+            quantile_us(0.5), quantile_us(0.99), quantile_us(0.999),
+            (double)max_ns_ * 1e-3, (unsigned long long)negative_);
+    }
+
+private:
+    uint64_t bins_[kBuckets + 1] = {};
+    uint64_t n_ = 0;
+    uint64_t sum_ns_ = 0;
+    uint64_t max_ns_ = 0;
+    uint64_t negative_ = 0;
+};
@@ -1,250 +1,990 @@
-// serial_logger_com9_csv.cpp
+// serial_logger.cpp
 // One CSV row per received line (split on '\n'), cleaner output.
-// Build (MSVC):  cl /std:c++17 /W4 /O2 serial_logger_com9_csv.cpp
-// Build (MinGW): g++ -std=c++17 -O2 -Wall serial_logger_com9_csv.cpp -o serial_logger_com9_csv.exe
-// Run: serial_logger_com9_csv.exe
+// Several Picos can be captured into one session; each port gets its own
+// reader thread and rows are tagged with the board ID of the sending device.
+// The port itself is handled by serial_port.h (Win32 or termios/poll).
+// Reader threads only read and timestamp into a lock-free ring per device; a
+// single writer thread parses, formats and writes in large batches, so a slow
+// disk never holds up the next read.
+// A lost port is reopened with backoff. When a Pico's counter goes backwards
+// (reset) a SEGMENT row starts a new clock epoch; the segment column tells
+// which epoch each row's us_value belongs to.
+// Capture errors are counted per device: the driver's line error counters
+// (serial_port.h) and protocol framing errors (malformed lines, gaps in the
+// Batch= sequence). When any of them changes, a COUNTERS row carries the
+// cumulative values, so an anomaly in the data can be told apart from bytes
+// lost on the way in.
+// On every (re)connect the logger asks for the firmware's hello (see
+// pico_protocol.h); it selects the decoder, gives the pin map that GPIO
+// numbers are checked against, and is kept in the session metadata.
+// Once per second a status line per device (rate, interval statistics, gaps,
+// Pico-side drops, per-GPIO rates; see live_stats.h) goes to stderr, so a
+// bad run shows up within seconds.
+// Build (MSVC):  cl /std:c++17 /W4 /O2 /EHsc serial_logger.cpp
+// Build (MinGW): g++ -std=c++17 -O2 -Wall serial_logger.cpp -o serial_logger.exe
+// Build (Linux): g++ -std=c++17 -O2 -Wall -pthread serial_logger.cpp -o serial_logger
+// Run: serial_logger.exe [options] [PORT ...]   (see --help)
+//      serial_logger.exe --calibrate[=SECONDS] [PORT]
 //
-// Output file: serial_YYYYMMDD_HHMM.csv
-
-#define NOMINMAX
-#include <windows.h>
-
+// Output file: <out-dir>/<session>.csv, session defaults to
+// serial_YYYYMMDD_HHMMSS. Files are created exclusively; if the name is
+// taken a _2, _3, ... suffix is added, so parallel instances never share one.
+// arrival_ns is the host monotonic clock (QPC / CLOCK_MONOTONIC, the clock
+// key_logger stamps with) taken when the read carrying the line returned.
+// Columns: arrival_ns,line_type,us_value,gpio,dropped,text,device,segment.
+// Every row, metadata included, has these columns, so the file loads in any
+// CSV reader. The first row is line_type SESSION: arrival_ns is the
+// monotonic clock at session start and text holds "id=.. wall=..", the only
+// place wall-clock time appears.
+// With --format bin the same rows go to <session>.col instead, fixed-width
+// columns in fixed-size blocks (layout in columnar_writer.h); free text is not
+// kept there, the session and device details are in the file header.
+// --calibrate measures the Pico crystal against the host monotonic clock
+// (default 600 s) and stores the ppb correction in the Pico's flash.
+
+#include "columnar_writer.h"
+#include "host_clock.h"
+#include "line_splitter.h"
+#include "live_stats.h"
+#include "pico_protocol.h"
+#include "serial_port.h"
+#include "spsc_ring.h"
+
+#include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <csignal>
 #include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
-static volatile std::sig_atomic_t g_stop = 0;
-static void on_sigint(int) { g_stop = 1; }
+// Set by the signal handler or the duration timer, read by every thread.
+// Lock-free, so it may be stored from a signal handler.
+static std::atomic<bool> g_stop{false};
+static_assert(std::atomic<bool>::is_always_lock_free, "g_stop is set from a signal handler");
+static void on_sigint(int) { g_stop.store(true); }
+
+// Formats into buf (>= 24 bytes), returns the length
+static int timestamp_iso_ms(char* buf, size_t size) {
+    LocalTime lt = local_time_now();
+    return std::snprintf(buf, size,
+                         "%04u-%02u-%02uT%02u:%02u:%02u.%03u",
+                         lt.year, lt.month, lt.day,
+                         lt.hour, lt.minute, lt.second, lt.millisecond);
+}
 
-static std::string timestamp_iso_ms() {
-    SYSTEMTIME st;
-    GetLocalTime(&st);
+static std::string make_session_id() {
+    LocalTime lt = local_time_now();
     char buf[64];
     std::snprintf(buf, sizeof(buf),
-                  "%04u-%02u-%02uT%02u:%02u:%02u.%03u",
-                  st.wYear, st.wMonth, st.wDay,
-                  st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
+                  "serial_%04u%02u%02u_%02u%02u%02u",
+                  lt.year, lt.month, lt.day, lt.hour, lt.minute, lt.second);
     return std::string(buf);
 }
 
-static std::string make_output_filename_day_minute() {
-    SYSTEMTIME st;
-    GetLocalTime(&st);
-    char buf[64];
-    std::snprintf(buf, sizeof(buf),
-                  "serial_%04u%02u%02u_%02u%02u.csv",
-                  st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute);
-    return std::string(buf);
+// Creates <dir>/<id><ext>, or <dir>/<id>_<n><ext> if that exists.
+// "x" makes the create atomic, so two instances cannot pick the same file.
+static std::FILE* create_session_file(const std::string& dir, std::string& id,
+                                      const char* ext, std::string& path) {
+    std::error_code ec;
+    if (!dir.empty()) std::filesystem::create_directories(dir, ec);
+
+    const std::string base = id;
+    for (int n = 1; n < 1000; n++) {
+        if (n > 1) id = base + "_" + std::to_string(n);
+        path = (std::filesystem::path(dir.empty() ? "." : dir) / (id + ext)).string();
+        if (std::FILE* f = std::fopen(path.c_str(), "wbx")) return f;
+        if (!std::filesystem::exists(path)) return nullptr;   // not a name clash
+    }
+    return nullptr;
+}
+
+// CSV escape: wrap in quotes and double any quotes inside
+static void append_csv_quoted(std::string& out, std::string_view s) {
+    out.push_back('"');
+    for (char c : s) {
+        if (c == '"') out += "\"\"";
+        else out.push_back(c);
+    }
+    out.push_back('"');
+}
+
+// ---- One capture source (one Pico on one port) ----
+// Each device keeps its own clock: us_value is only comparable between rows
+// with the same device column.
+
+constexpr int kReconnectMinMs = 100;
+constexpr int kReconnectMaxMs = 5000;
+constexpr size_t kChunkBytes = 4096;
+constexpr size_t kRingChunks = 1024;          // 4 MB of backlog per device
+constexpr size_t kWriteBatchBytes = 1 << 18;  // write once this much is formatted
+constexpr uint64_t kFlushIntervalNs = 250000000ULL;
+constexpr uint64_t kStatusIntervalNs = 1000000000ULL;
+constexpr uint64_t kErrorPollNs = 1000000000ULL;
+
+enum ChunkKind : uint32_t {
+    kChunkData,
+    kChunkDisconnect,   // data holds the error text
+    kChunkReconnect,
+    kChunkOverrun,      // reads dropped on a full ring before the next chunk;
+                        // data holds the count (uint64_t), arrival_ns the first
+};
+
+// One read, stamped when it returned, or a connection event in stream order
+struct Chunk {
+    uint64_t arrival_ns;
+    uint32_t kind;
+    uint32_t len;
+    char data[kChunkBytes];
+};
+
+struct Device {
+    std::string port_name;     // as given on the command line
+    uint8_t index = 0;         // device column of the binary format
+    uint32_t baud = 115200;
+    SerialPort port;           // reader thread only
+    SpscRing<Chunk> ring{kRingChunks};
+    std::atomic<bool> reader_done{false};
+    std::atomic<uint64_t> dropped_chunks{0};  // ring full, reader had to drop
+    uint64_t unqueued_drops = 0;              // reader: drops not yet in the ring
+    uint64_t first_drop_ns = 0;
+
+    // Driver line errors summed over reconnects (reader writes, writer reads)
+    std::atomic<uint64_t> port_overrun{0};
+    std::atomic<uint64_t> port_rx_overflow{0};
+    std::atomic<uint64_t> port_framing{0};
+    std::atomic<uint64_t> port_parity{0};
+    std::atomic<uint64_t> port_break{0};
+
+    // Writer-side state
+    LineSplitter splitter;
+    std::string board_id;      // learned from the Pico, port name until then
+    LineDecoder decode = parse_line;
+    std::string hello;         // last hello line, empty for older firmware
+    uint64_t pin_mask = 0;     // GPIOs the hello announced, 0: unknown
+    uint64_t reported_drops = 0;
+    uint32_t segment = 0;      // clock epoch, bumped on Pico reset
+    uint32_t reconnects = 0;
+    uint64_t data_lines = 0;
+    LiveStats stats;           // current segment
+    long long last_us = -1;
+    long long batch_seq = -1;  // last Batch= tag
+    uint64_t malformed = 0;    // lines that do not match the protocol
+    uint64_t batch_gaps = 0;   // Batch= tags missing from the sequence
+    std::string reported_errors;
+};
+
+// Host-side row types, numbered after the protocol's LineType values
+enum HostRowType : uint8_t {
+    kRowSegment = 16,
+    kRowDisconnect,
+    kRowReconnect,
+    kRowHostOverrun,
+    kRowCounters,
+    kRowSession,
+};
+
+static const char* row_type_name(uint8_t type) {
+    switch (type) {
+    case kRowSegment:     return "SEGMENT";
+    case kRowDisconnect:  return "DISCONNECT";
+    case kRowReconnect:   return "RECONNECT";
+    case kRowHostOverrun: return "HOST_OVERRUN";
+    case kRowCounters:    return "COUNTERS";
+    case kRowSession:     return "SESSION";
+    }
+    return line_type_name((LineType)type);
+}
+
+// Session file, owned by the writer thread
+struct Session {
+    std::FILE* f = nullptr;
+    std::unique_ptr<ColumnarWriter> bin;   // --format bin, else CSV text
+    std::string out;           // formatted CSV rows not yet written
+    uint64_t last_flush_ns = 0;
+    bool status = true;        // live status lines on stderr
+    uint64_t last_status_ns = 0;
+};
+
+// Blank if negative (not present)
+static void append_num(std::string& out, long long v) {
+    if (v < 0) return;
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, (size_t)(res.ptr - buf));
+}
+
+// CSV: arrival_ns,line_type,us_value,gpio,dropped,text,device,segment
+static void append_row(std::string& out, uint64_t arrival_ns, uint8_t type,
+                       const Record& r, std::string_view device, uint32_t segment) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), arrival_ns);
+    out.append(buf, (size_t)(res.ptr - buf));
+    out += ',';
+    out += row_type_name(type);
+    out += ',';
+    append_num(out, r.us);
+    out += ',';
+    append_num(out, r.gpio);
+    out += ',';
+    append_num(out, r.dropped);
+    out += ',';
+    if (!r.text.empty()) append_csv_quoted(out, r.text);
+    out += ',';
+    out.append(device.data(), device.size());
+    out += ',';
+    append_num(out, segment);
+    out += '\n';
+}
+
+// Binary: the one numeric value each row type carries goes in pico_us
+static ColumnarRow make_column_row(uint64_t arrival_ns, uint8_t type, const Record& r,
+                                   const Device& dev) {
+    ColumnarRow row;
+    row.arrival_ns = arrival_ns;
+    row.pico_us = r.us;
+    if (type == (uint8_t)LineType::Heartbeat || type == kRowCounters) row.pico_us = r.dropped;
+    else if (type == (uint8_t)LineType::Hello) row.pico_us = r.proto;
+    else if (type == (uint8_t)LineType::Cal) row.pico_us = r.has_ppb ? r.ppb : -1;
+    row.seq = dev.batch_seq >= 0 ? (uint32_t)dev.batch_seq : 0xFFFFFFFFu;
+    row.segment = (uint16_t)dev.segment;
+    row.gpio = (int8_t)r.gpio;
+    row.type = type;
+    row.device = dev.index;
+    return row;
+}
+
+static void emit_row(Session& session, uint64_t arrival_ns, uint8_t type,
+                     const Record& r, const Device& dev) {
+    if (session.bin) session.bin->add(make_column_row(arrival_ns, type, r, dev));
+    else append_row(session.out, arrival_ns, type, r, dev.board_id, dev.segment);
+}
+
+static void emit_event(Session& session, uint64_t arrival_ns, uint8_t type,
+                       std::string_view text, const Device& dev) {
+    Record r;
+    r.text = text;
+    emit_row(session, arrival_ns, type, r, dev);
+}
+
+static void start_segment(Device& dev, uint64_t arrival_ns, const char* reason, Session& session) {
+    dev.stats.print_summary(stderr, dev.board_id.c_str(), dev.segment);
+    dev.stats.reset();
+    dev.segment++;
+    dev.last_us = -1;
+    dev.batch_seq = -1;
+    std::fprintf(stderr, "%s: segment %u (%s)\n", dev.board_id.c_str(), dev.segment, reason);
+    emit_event(session, arrival_ns, kRowSegment, reason, dev);
 }
 
-static bool configure_port(HANDLE h, DWORD baud) {
-    DCB dcb{};
-    dcb.DCBlength = sizeof(dcb);
-    if (!GetCommState(h, &dcb)) return false;
+static bool is_banner(std::string_view line) {
+    return has_prefix(line, "Pico ") && line.find(" started") != std::string_view::npos;
+}
 
-    dcb.BaudRate = baud;
-    dcb.ByteSize = 8;
-    dcb.Parity   = NOPARITY;
-    dcb.StopBits = ONESTOPBIT;
+// Switches the device to what its firmware announced
+static void apply_hello(Device& dev, const Record& r) {
+    if (dev.hello == r.text) return;   // header and HELLO answer repeat it
+    dev.hello.assign(r.text.data(), r.text.size());
+    std::fprintf(stderr, "%s: %s\n", dev.port_name.c_str(), dev.hello.c_str());
+
+    dev.decode = select_decoder(r.proto, r.encoding);
+    if (!dev.decode) {
+        std::fprintf(stderr, "%s: protocol %d/%.*s not supported (up to %d/text), lines kept as text\n",
+                     dev.port_name.c_str(), r.proto, (int)r.encoding.size(), r.encoding.data(),
+                     kProtocolVersion);
+        dev.decode = parse_raw;
+    }
 
-    // No flow control
-    dcb.fOutxCtsFlow = FALSE;
-    dcb.fOutxDsrFlow = FALSE;
-    dcb.fDtrControl  = DTR_CONTROL_ENABLE;
-    dcb.fRtsControl  = RTS_CONTROL_ENABLE;
-    dcb.fOutX        = FALSE;
-    dcb.fInX         = FALSE;
+    dev.pin_mask = 0;
+    const std::string_view pins = field_value(r.text, "pins");
+    size_t i = 0;
+    long long pin;
+    while (parse_uint(pins, i, pin)) {
+        if (pin < 64) dev.pin_mask |= 1ULL << pin;
+        if (i >= pins.size() || pins[i] != ',') break;
+        i++;
+    }
+}
 
-    if (!SetCommState(h, &dcb)) return false;
+// arrival_ns: host monotonic ns of the read that completed the line
+static void handle_line(Device& dev, std::string_view line, uint64_t arrival_ns, Session& session) {
+    Record r = dev.decode(line);
 
-    COMMTIMEOUTS to{};
-    to.ReadIntervalTimeout      = 50;
-    to.ReadTotalTimeoutConstant = 100;
-    if (!SetCommTimeouts(h, &to)) return false;
+    if (r.type == LineType::Batch && r.seq >= 0) {
+        // Sequence restarts at 0 with the firmware
+        if (dev.batch_seq >= 0 && r.seq != dev.batch_seq + 1 && r.seq != 0) {
+            dev.batch_gaps += r.seq > dev.batch_seq ? (uint64_t)(r.seq - dev.batch_seq - 1) : 1;
+        }
+        dev.batch_seq = r.seq;
+    }
+    if (r.type == LineType::Hello) apply_hello(dev, r);
+    if (r.type == LineType::Batch || r.type == LineType::Board || r.type == LineType::Hello) {
+        if (!r.board.empty() && r.board != dev.board_id) {
+            dev.board_id.assign(r.board.data(), r.board.size());
+            std::fprintf(stderr, "%s: board %s\n", dev.port_name.c_str(), dev.board_id.c_str());
+        }
+        // Batch tags are framing only, no row for them
+        if (r.type == LineType::Batch) return;
+        r.text = line;
+    }
+
+    // Unparsed rest of a data or heartbeat line, or a line that starts like
+    // data but is not: bytes were lost or merged somewhere
+    if (((r.type == LineType::Data || r.type == LineType::Heartbeat) && !r.text.empty()) ||
+        (r.type == LineType::Info && is_digit(line[0]) && dev.decode == parse_line) ||
+        (r.gpio >= 0 && dev.pin_mask != 0 && !(dev.pin_mask >> r.gpio & 1))) {
+        dev.malformed++;
+    }
 
-    SetupComm(h, 1 << 16, 1 << 16);
-    PurgeComm(h, PURGE_RXCLEAR | PURGE_TXCLEAR);
+    if (r.type == LineType::Data) {
+        if (dev.last_us >= 0 && r.us < dev.last_us) {
+            start_segment(dev, arrival_ns, "counter went backwards", session);
+        }
+        dev.last_us = r.us;
+        dev.data_lines++;
+        dev.stats.on_event(r.gpio, r.us);
+    } else if (r.type == LineType::Heartbeat) {
+        dev.stats.on_heartbeat(r.dropped);
+    } else if (r.type == LineType::Info && dev.last_us >= 0 && is_banner(line)) {
+        start_segment(dev, arrival_ns, "firmware restarted", session);
+    }
+
+    emit_row(session, arrival_ns, (uint8_t)r.type, r, dev);
+}
+
+// Puts the drops since the last queued chunk into the ring as a marker, so
+// the writer sees the gap exactly where it happened. False if still full.
+static bool queue_overrun(Device& dev) {
+    if (dev.unqueued_drops == 0) return true;
+    Chunk* c = dev.ring.begin_push();
+    if (!c) return false;
+    c->arrival_ns = dev.first_drop_ns;
+    c->kind = kChunkOverrun;
+    c->len = (uint32_t)sizeof(uint64_t);
+    std::memcpy(c->data, &dev.unqueued_drops, sizeof(uint64_t));
+    dev.ring.end_push();
+    dev.unqueued_drops = 0;
     return true;
 }
 
-static bool file_is_empty(std::FILE* f) {
-    long cur = std::ftell(f);
-    std::fseek(f, 0, SEEK_END);
-    long end = std::ftell(f);
-    std::fseek(f, cur, SEEK_SET);
-    return end == 0;
+// Queues a connection event. The port is down, so waiting for a free slot
+// cannot lose serial data.
+static void push_event(Device& dev, uint32_t kind, const std::string& text) {
+    Chunk* c;
+    while (!queue_overrun(dev) || !(c = dev.ring.begin_push())) {
+        if (g_stop) return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    c->arrival_ns = mono_now_ns();
+    c->kind = kind;
+    c->len = (uint32_t)std::min(text.size(), sizeof(c->data));
+    std::memcpy(c->data, text.data(), c->len);
+    dev.ring.end_push();
 }
 
-// CSV escape: wrap in quotes and double any quotes inside
-static std::string csv_quote(const std::string& s) {
-    std::string out;
-    out.reserve(s.size() + 2);
-    out.push_back('"');
-    for (char c : s) {
-        if (c == '"') out += "\"\"";
-        else out.push_back(c);
+// Adds what the driver counted since the last call to the device totals
+static void poll_port_errors(Device& dev, SerialErrors& last) {
+    SerialErrors now;
+    if (!dev.port.error_counters(now)) return;
+    dev.port_overrun.fetch_add(now.overrun - last.overrun, std::memory_order_relaxed);
+    dev.port_rx_overflow.fetch_add(now.rx_overflow - last.rx_overflow, std::memory_order_relaxed);
+    dev.port_framing.fetch_add(now.framing - last.framing, std::memory_order_relaxed);
+    dev.port_parity.fetch_add(now.parity - last.parity, std::memory_order_relaxed);
+    dev.port_break.fetch_add(now.brk - last.brk, std::memory_order_relaxed);
+    last = now;
+}
+
+// Old firmware ignores unknown commands, so this is always safe to send
+static void request_hello(Device& dev) {
+    static const char kHello[] = "HELLO\n";
+    dev.port.write(kHello, sizeof(kHello) - 1);
+}
+
+static void sleep_unless_stopped(int ms) {
+    for (int waited = 0; waited < ms && !g_stop; waited += 20) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
     }
-    out.push_back('"');
-    return out;
 }
 
-static std::string trim_crlf(std::string s) {
-    while (!s.empty() && (s.back() == '\r' || s.back() == '\n')) s.pop_back();
-    return s;
+// Reader thread: read, stamp, publish. Nothing here waits on the writer.
+static void read_device(Device& dev) {
+    int backoff_ms = kReconnectMinMs;
+    SerialErrors port_errors;             // counters of the current connection
+    uint64_t last_poll_ns = mono_now_ns();
+    request_hello(dev);
+    while (!g_stop) {
+        if (!dev.port.is_open()) {
+            sleep_unless_stopped(backoff_ms);
+            if (g_stop) break;
+            if (!dev.port.open(dev.port_name, dev.baud)) {
+                backoff_ms = std::min(backoff_ms * 2, kReconnectMaxMs);
+                continue;
+            }
+            backoff_ms = kReconnectMinMs;
+            port_errors = SerialErrors();
+            std::fprintf(stderr, "%s: reconnected\n", dev.port_name.c_str());
+            push_event(dev, kChunkReconnect, "port reopened");
+            request_hello(dev);
+            continue;
+        }
+
+        const uint64_t now = mono_now_ns();
+        if (now - last_poll_ns >= kErrorPollNs) {
+            poll_port_errors(dev, port_errors);
+            last_poll_ns = now;
+        }
+
+        // A chunk may only be queued after the marker of earlier drops
+        Chunk* c = queue_overrun(dev) ? dev.ring.begin_push() : nullptr;
+        Chunk overflow;                       // read target while the ring is full
+        if (!c) c = &overflow;
+
+        long read_n = dev.port.read(c->data, sizeof(c->data), 100);
+        if (read_n < 0) {
+            std::fprintf(stderr, "%s, reconnecting\n", dev.port.last_error().c_str());
+            std::string err = dev.port.last_error();
+            poll_port_errors(dev, port_errors);
+            dev.port.close();
+            push_event(dev, kChunkDisconnect, err);
+            continue;
+        }
+        if (read_n == 0) continue;
+        c->arrival_ns = mono_now_ns();
+        c->kind = kChunkData;
+        c->len = (uint32_t)read_n;
+
+        if (c == &overflow) {
+            if (dev.unqueued_drops++ == 0) dev.first_drop_ns = c->arrival_ns;
+            dev.dropped_chunks.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            dev.ring.end_push();
+        }
+    }
+    queue_overrun(dev);     // if still full, the writer reports the rest at the end
+    if (dev.port.is_open()) poll_port_errors(dev, port_errors);
+    dev.reader_done.store(true, std::memory_order_release);
 }
 
-struct ParsedLine {
-    std::string type;   // DATA / HEARTBEAT / INFO
-    long long us_value; // -1 if not present
-};
+static void write_out(Session& session, bool flush) {
+    if (!session.out.empty()) {
+        std::fwrite(session.out.data(), 1, session.out.size(), session.f);
+        session.out.clear();
+    }
+    if (flush) {
+        if (session.bin) session.bin->flush();
+        std::fflush(session.f);
+        session.last_flush_ns = mono_now_ns();
+    }
+}
+
+// Cumulative capture error counters as "name=value ..."; returns the total
+static uint64_t format_errors(const Device& dev, char* buf, size_t size) {
+    const uint64_t v[] = {
+        dev.port_overrun.load(std::memory_order_relaxed),
+        dev.port_rx_overflow.load(std::memory_order_relaxed),
+        dev.port_framing.load(std::memory_order_relaxed),
+        dev.port_parity.load(std::memory_order_relaxed),
+        dev.port_break.load(std::memory_order_relaxed),
+        dev.malformed,
+        dev.batch_gaps,
+    };
+    std::snprintf(buf, size,
+                  "overrun=%llu rx_overflow=%llu framing=%llu parity=%llu break=%llu "
+                  "malformed=%llu batch_gaps=%llu",
+                  (unsigned long long)v[0], (unsigned long long)v[1], (unsigned long long)v[2],
+                  (unsigned long long)v[3], (unsigned long long)v[4], (unsigned long long)v[5],
+                  (unsigned long long)v[6]);
+    uint64_t total = 0;
+    for (uint64_t x : v) total += x;
+    return total;
+}
 
-static ParsedLine classify_line(const std::string& line) {
-    ParsedLine p;
-    p.us_value = -1;
+// COUNTERS row (total in the dropped column) when any counter has moved
+static void report_errors(Device& dev, uint64_t now_ns, Session& session) {
+    char text[192];
+    const uint64_t total = format_errors(dev, text, sizeof(text));
+    if (total == 0 || dev.reported_errors == text) return;
+    dev.reported_errors = text;
+    std::fprintf(stderr, "%s: capture errors: %s\n", dev.board_id.c_str(), text);
+
+    Record r;
+    r.dropped = (long long)total;
+    r.text = dev.reported_errors;
+    emit_row(session, now_ns, kRowCounters, r, dev);
+}
 
-    if (line.rfind("Heartbeat.", 0) == 0) {
-        p.type = "HEARTBEAT";
-        return p;
+// HOST_OVERRUN row for chunks the reader could not queue, at the place in
+// the stream where they were lost
+static void report_overrun(Device& dev, uint64_t arrival_ns, uint64_t drops, Session& session) {
+    char text[64];
+    std::snprintf(text, sizeof(text), "host ring full, %llu chunks dropped", (unsigned long long)drops);
+    emit_event(session, arrival_ns, kRowHostOverrun, text, dev);
+    dev.reported_drops += drops;
+    // Bytes were lost mid-line; restart at the next line boundary
+    dev.splitter.clear();
+}
+
+// Moves every queued chunk of one device into formatted rows.
+// Returns true if there was anything to do.
+static bool drain_device(Device& dev, Session& session) {
+    bool any = false;
+
+    while (Chunk* c = dev.ring.front()) {
+        if (c->kind == kChunkOverrun) {
+            uint64_t drops;
+            std::memcpy(&drops, c->data, sizeof(drops));
+            report_overrun(dev, c->arrival_ns, drops, session);
+            dev.ring.pop();
+            any = true;
+            continue;
+        }
+        if (c->kind != kChunkData) {
+            // Whatever was mid-line when the port went away is gone
+            dev.splitter.clear();
+            if (c->kind == kChunkReconnect) dev.reconnects++;
+            emit_event(session, c->arrival_ns,
+                       c->kind == kChunkReconnect ? kRowReconnect : kRowDisconnect,
+                       std::string_view(c->data, c->len), dev);
+            dev.ring.pop();
+            any = true;
+            continue;
+        }
+
+        size_t done = 0;
+        while (done < c->len) {
+            const size_t n = std::min((size_t)c->len - done, dev.splitter.write_space());
+            std::memcpy(dev.splitter.write_ptr(), c->data + done, n);
+            dev.splitter.commit(n);
+            done += n;
+            dev.splitter.drain([&](std::string_view line) {
+                handle_line(dev, line, c->arrival_ns, session);
+            });
+        }
+        dev.ring.pop();
+        any = true;
+
+        if (session.out.size() >= kWriteBatchBytes) write_out(session, false);
     }
+    return any;
+}
 
-    // Parse "<digits> us"
-    // allow leading spaces
-    size_t i = 0;
-    while (i < line.size() && std::isspace((unsigned char)line[i])) i++;
-    size_t start = i;
-    while (i < line.size() && std::isdigit((unsigned char)line[i])) i++;
-
-    if (i > start) {
-        // skip spaces
-        size_t j = i;
-        while (j < line.size() && std::isspace((unsigned char)line[j])) j++;
-        if (j + 2 <= line.size() && line.compare(j, 2, "us") == 0) {
-            // Convert digits
-            // (safe enough for typical microsecond counters)
-            try {
-                p.us_value = std::stoll(line.substr(start, i - start));
-                p.type = "DATA";
-                return p;
-            } catch (...) {
-                // fall through
+// Writer thread: runs until every reader has finished and its ring is empty.
+static void write_session(std::vector<std::unique_ptr<Device>>& devices, Session& session) {
+    session.last_flush_ns = mono_now_ns();
+    session.last_status_ns = session.last_flush_ns;
+    for (;;) {
+        bool any = false;
+        bool all_done = true;
+        for (auto& dev : devices) {
+            const bool done = dev->reader_done.load(std::memory_order_acquire);
+            any |= drain_device(*dev, session);
+            all_done &= done;
+        }
+
+        const uint64_t now = mono_now_ns();
+        if (now - session.last_flush_ns >= kFlushIntervalNs) write_out(session, true);
+        if (now - session.last_status_ns >= kStatusIntervalNs) {
+            const double window_s = (double)(now - session.last_status_ns) * 1e-9;
+            for (auto& dev : devices) {
+                report_errors(*dev, now, session);
+                if (!session.status) continue;
+                char line[640];
+                dev->stats.format_status(line, sizeof(line), window_s);
+                std::fprintf(stderr, "[%s seg %u] %s\n", dev->board_id.c_str(), dev->segment, line);
             }
+            session.last_status_ns = now;
         }
+        if (all_done && !any) break;
+        if (!any) std::this_thread::sleep_for(std::chrono::milliseconds(2));
     }
 
-    p.type = "INFO";
-    return p;
+    // Optional: flush any final partial line on exit
+    for (auto& dev : devices) {
+        std::string_view rest = dev->splitter.remainder();
+        if (!rest.empty()) handle_line(*dev, rest, mono_now_ns(), session);
+        // Drops the reader could not queue before it stopped
+        const uint64_t drops = dev->dropped_chunks.load(std::memory_order_relaxed);
+        if (drops != dev->reported_drops) {
+            report_overrun(*dev, dev->first_drop_ns, drops - dev->reported_drops, session);
+        }
+    }
+    for (auto& dev : devices) report_errors(*dev, mono_now_ns(), session);
+    write_out(session, true);
 }
 
-int main() {
-    std::signal(SIGINT, on_sigint);
+// ---- Crystal-drift calibration ----
+// Sends "SYNC" every kSyncPeriodMs and pairs each "Sync=<us>" answer with the
+// QPC midpoint of the round trip. Only round trips close to the fastest one
+// are kept (the Pico may be busy in a pulse when a request arrives), then a
+// least-squares fit of Pico time over host time gives the frequency error.
 
-    constexpr DWORD kBaud = 115200;
-    const char* port_name = R"(\\.\COM9)";
-    std::string out_path = make_output_filename_day_minute();
-
-    HANDLE h = CreateFileA(
-        port_name,
-        GENERIC_READ,
-        0,
-        nullptr,
-        OPEN_EXISTING,
-        FILE_ATTRIBUTE_NORMAL,
-        nullptr
-    );
-    if (h == INVALID_HANDLE_VALUE) {
-        std::fprintf(stderr, "Failed to open %s (err=%lu)\n", port_name, GetLastError());
-        return 1;
+struct SyncSample {
+    double host_s;   // QPC midpoint of the round trip, seconds from start
+    double rtt_s;
+    double pico_s;   // Pico time_us_64, seconds
+};
+
+static bool write_command(SerialPort& port, const char* cmd) {
+    return port.write(cmd, std::strlen(cmd));
+}
+
+// Reads until a line starting with prefix arrives; other lines are skipped.
+// Lines after the match stay in the splitter for the next call.
+static bool wait_for_line(SerialPort& port, LineSplitter& splitter, const char* prefix,
+                          double deadline_s, std::string& line) {
+    for (;;) {
+        const bool found = splitter.drain_until([&](std::string_view l) {
+            if (!has_prefix(l, prefix)) return false;
+            line.assign(l.data(), l.size());
+            return true;
+        });
+        if (found) return true;
+        if (g_stop || mono_now_s() > deadline_s) return false;
+
+        long read_n = port.read(splitter.write_ptr(), splitter.write_space(), 100);
+        if (read_n < 0) return false;
+        splitter.commit((size_t)read_n);
+    }
+}
+
+static int run_calibration(Device& dev, double duration_s) {
+    constexpr int kSyncPeriodMs = 200;
+
+    std::fprintf(stderr, "Calibrating %s for %.0f s. Ctrl+C to abort.\n",
+                 dev.port.name().c_str(), duration_s);
+
+    std::vector<SyncSample> samples;
+    LineSplitter splitter(4096);
+    std::string line;
+    const double t0 = mono_now_s();
+
+    while (!g_stop && mono_now_s() - t0 < duration_s) {
+        const double sent = mono_now_s();
+        if (!write_command(dev.port, "SYNC\n")) {
+            std::fprintf(stderr, "%s\n", dev.port.last_error().c_str());
+            return 1;
+        }
+        if (wait_for_line(dev.port, splitter, "Sync=", sent + 0.5, line)) {
+            const double recv = mono_now_s();
+            SyncSample s;
+            s.host_s = 0.5 * (sent + recv) - t0;
+            s.rtt_s  = recv - sent;
+            s.pico_s = (double)parse_line(line).us * 1e-6;
+            samples.push_back(s);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(kSyncPeriodMs));
     }
 
-    if (!configure_port(h, kBaud)) {
-        std::fprintf(stderr, "Failed to configure port (err=%lu)\n", GetLastError());
-        CloseHandle(h);
+    if (samples.size() < 10) {
+        std::fprintf(stderr, "Not enough sync answers (%zu)\n", samples.size());
         return 1;
     }
 
-    std::FILE* f = std::fopen(out_path.c_str(), "ab");
-    if (!f) {
-        std::fprintf(stderr, "Failed to open output file: %s\n", out_path.c_str());
-        CloseHandle(h);
+    double min_rtt = samples[0].rtt_s;
+    for (const auto& s : samples) min_rtt = std::min(min_rtt, s.rtt_s);
+    const double max_rtt = min_rtt + 0.0005;
+
+    // Least squares over centred sums
+    double sx = 0, sy = 0;
+    size_t n = 0;
+    for (const auto& s : samples) {
+        if (s.rtt_s > max_rtt) continue;
+        sx += s.host_s;
+        sy += s.pico_s;
+        n++;
+    }
+    if (n < 10) {
+        std::fprintf(stderr, "Not enough fast round trips (%zu)\n", n);
+        return 1;
+    }
+    const double mx = sx / (double)n;
+    const double my = sy / (double)n;
+    double sxx = 0, sxy = 0, span = 0;
+    for (const auto& s : samples) {
+        if (s.rtt_s > max_rtt) continue;
+        sxx += (s.host_s - mx) * (s.host_s - mx);
+        sxy += (s.host_s - mx) * (s.pico_s - my);
+        span = std::max(span, s.host_s);
+    }
+    const double slope = sxy / sxx;
+    const double ppm = (slope - 1.0) * 1e6;
+    const long ppb = std::lround(ppm * 1000.0);
+
+    std::fprintf(stderr, "%zu/%zu samples used (min rtt %.3f ms) over %.0f s: %+.3f ppm\n",
+                 n, samples.size(), min_rtt * 1e3, span, ppm);
+
+    char cmd[64];
+    std::snprintf(cmd, sizeof(cmd), "CAL ppb=%ld\n", ppb);
+    if (!write_command(dev.port, cmd) ||
+        !wait_for_line(dev.port, splitter, "Calibration", mono_now_s() + 2.0, line) ||
+        !has_prefix(line, "Calibration ppb=")) {
+        std::fprintf(stderr, "Pico did not confirm the calibration\n");
         return 1;
     }
+    std::fprintf(stderr, "Stored: %s\n", line.c_str());
+    return 0;
+}
 
-    if (file_is_empty(f)) {
-        std::fprintf(f, "timestamp_iso,line_type,us_value,text\n");
-        std::fflush(f);
+// Header text of a binary session file; rewritten on close, when the board
+// IDs are known.
+static std::string session_meta(const std::string& id, const char* wall, uint64_t mono_ns,
+                                const std::vector<std::unique_ptr<Device>>& devices) {
+    std::string meta;
+    char line[384];
+    std::snprintf(line, sizeof(line), "session id=%s wall=%s mono_ns=%llu\n",
+                  id.c_str(), wall, (unsigned long long)mono_ns);
+    meta += line;
+    meta += "columns arrival_ns:u64 pico_us:i64 seq:u32 segment:u16 gpio:i8 type:u8 device:u8\n";
+    meta += "types";
+    for (uint8_t t = 0; t <= (uint8_t)LineType::Hello; t++) {
+        std::snprintf(line, sizeof(line), " %u=%s", t, row_type_name(t));
+        meta += line;
     }
+    for (uint8_t t = kRowSegment; t <= kRowSession; t++) {
+        std::snprintf(line, sizeof(line), " %u=%s", t, row_type_name(t));
+        meta += line;
+    }
+    meta += '\n';
+    for (const auto& dev : devices) {
+        char errors[192];
+        format_errors(*dev, errors, sizeof(errors));
+        std::snprintf(line, sizeof(line), "device %u port=%s board=%s segments=%u %s\n",
+                      dev->index, dev->port_name.c_str(), dev->board_id.c_str(), dev->segment + 1,
+                      errors);
+        meta += line;
+        if (!dev->hello.empty()) {
+            meta += "hello " + std::to_string(dev->index) + " " + dev->hello + "\n";
+        }
+    }
+    return meta;
+}
 
-    std::fprintf(stderr, "Logging from COM9 at %lu baud to %s\n",
-                 (unsigned long)kBaud, out_path.c_str());
-    std::fprintf(stderr, "Line-based parsing (split on \\n). Ctrl+C to stop.\n");
+// ---- Command line ----
+
+struct Options {
+    std::vector<std::string> ports;
+    uint32_t baud = 115200;
+    std::string out_dir;
+    std::string session_id;      // empty: serial_YYYYMMDD_HHMMSS
+    std::string format = "csv";
+    double duration_s = 0;       // 0: until Ctrl+C
+    bool status = true;
+    bool calibrate = false;
+    double calibrate_s = 600.0;
+};
 
-    std::vector<uint8_t> buf(4096);
-    std::string pending;      // accumulates partial line across reads
-    pending.reserve(8192);
+static void print_usage(const char* argv0) {
+    std::fprintf(stderr,
+        "Usage: %s [options] [PORT ...]\n"
+        "  -p, --port PORT        port to capture, repeatable (default " SERIAL_DEFAULT_PORT ")\n"
+        "  -b, --baud N           baud rate (default 115200)\n"
+        "  -o, --out-dir DIR      output directory (default .)\n"
+        "  -s, --session ID       session ID / file stem (default serial_YYYYMMDD_HHMMSS)\n"
+        "  -f, --format FMT       output format: csv (default) or bin\n"
+        "  -d, --duration SEC     stop after SEC seconds (default: until Ctrl+C)\n"
+        "  -q, --quiet            no live status lines\n"
+        "      --calibrate[=SEC]  measure and store the Pico clock correction (default 600 s)\n"
+        "  -h, --help\n",
+        argv0);
+}
 
-    while (!g_stop) {
-        DWORD read_n = 0;
-        BOOL ok = ReadFile(h, buf.data(), (DWORD)buf.size(), &read_n, nullptr);
-        if (!ok) {
-            std::fprintf(stderr, "ReadFile failed (err=%lu)\n", GetLastError());
-            break;
-        }
-        if (read_n == 0) continue;
+// A positive, finite number of seconds and nothing else
+static bool parse_seconds(const char* s, double& out) {
+    char* end = nullptr;
+    const double v = std::strtod(s, &end);
+    if (end == s || *end != '\0' || !(v > 0.0) || !std::isfinite(v)) return false;
+    out = v;
+    return true;
+}
 
-        pending.append((const char*)buf.data(), (size_t)read_n);
-
-        // Extract complete lines by '\n'
-        for (;;) {
-            size_t pos = pending.find('\n');
-            if (pos == std::string::npos) break;
-
-            std::string line = pending.substr(0, pos + 1);
-            pending.erase(0, pos + 1);
-
-            line = trim_crlf(line);
-            if (line.empty()) continue;
-
-            ParsedLine pl = classify_line(line);
-            std::string ts = timestamp_iso_ms();
-
-            // us_value blank if not present
-            if (pl.us_value >= 0) {
-                std::fprintf(f, "%s,%s,%lld,%s\n",
-                             ts.c_str(),
-                             pl.type.c_str(),
-                             pl.us_value,
-                             csv_quote(line).c_str());
-            } else {
-                std::fprintf(f, "%s,%s,,%s\n",
-                             ts.c_str(),
-                             pl.type.c_str(),
-                             csv_quote(line).c_str());
+// Returns false (after printing why) if the command line is unusable.
+static bool parse_args(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        auto value = [&](const char* name) -> const char* {
+            if (i + 1 >= argc) {
+                std::fprintf(stderr, "%s needs a value\n", name);
+                return nullptr;
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return false;
+        } else if (arg == "-p" || arg == "--port") {
+            const char* v = value("--port");
+            if (!v) return false;
+            opt.ports.push_back(v);
+        } else if (arg == "-b" || arg == "--baud") {
+            const char* v = value("--baud");
+            if (!v) return false;
+            char* end = nullptr;
+            const unsigned long baud = std::strtoul(v, &end, 10);
+            if (*end != '\0' || !std::isdigit((unsigned char)v[0]) || baud == 0 || baud > UINT32_MAX) {
+                std::fprintf(stderr, "Bad --baud %s\n", v);
+                print_usage(argv[0]);
+                return false;
             }
+            opt.baud = (uint32_t)baud;
+        } else if (arg == "-o" || arg == "--out-dir") {
+            const char* v = value("--out-dir");
+            if (!v) return false;
+            opt.out_dir = v;
+        } else if (arg == "-s" || arg == "--session") {
+            const char* v = value("--session");
+            if (!v) return false;
+            opt.session_id = v;
+        } else if (arg == "-f" || arg == "--format") {
+            const char* v = value("--format");
+            if (!v) return false;
+            opt.format = v;
+        } else if (arg == "-d" || arg == "--duration") {
+            const char* v = value("--duration");
+            if (!v) return false;
+            if (!parse_seconds(v, opt.duration_s)) {
+                std::fprintf(stderr, "Bad --duration %s\n", v);
+                print_usage(argv[0]);
+                return false;
+            }
+        } else if (arg == "-q" || arg == "--quiet") {
+            opt.status = false;
+        } else if (has_prefix(arg, "--calibrate")) {
+            opt.calibrate = true;
+            if (arg.size() > 11 && (arg[11] != '=' || !parse_seconds(arg.c_str() + 12, opt.calibrate_s))) {
+                std::fprintf(stderr, "Bad %s\n", arg.c_str());
+                print_usage(argv[0]);
+                return false;
+            }
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            print_usage(argv[0]);
+            return false;
+        } else {
+            opt.ports.push_back(arg);
         }
+    }
 
-        std::fflush(f);
+    if (opt.ports.empty()) opt.ports.push_back(SERIAL_DEFAULT_PORT);
+    if (opt.format != "csv" && opt.format != "bin") {
+        std::fprintf(stderr, "Unknown format %s\n", opt.format.c_str());
+        return false;
     }
+    if (opt.session_id.empty()) opt.session_id = make_session_id();
+    return true;
+}
 
-    // Optional: flush any final partial line on exit
-    pending = trim_crlf(pending);
-    if (!pending.empty()) {
-        ParsedLine pl = classify_line(pending);
-        std::string ts = timestamp_iso_ms();
-        if (pl.us_value >= 0) {
-            std::fprintf(f, "%s,%s,%lld,%s\n",
-                         ts.c_str(), pl.type.c_str(), pl.us_value, csv_quote(pending).c_str());
-        } else {
-            std::fprintf(f, "%s,%s,,%s\n",
-                         ts.c_str(), pl.type.c_str(), csv_quote(pending).c_str());
+int main(int argc, char** argv) {
+    std::signal(SIGINT, on_sigint);
+
+    Options opt;
+    if (!parse_args(argc, argv, opt)) return 2;
+
+    std::vector<std::unique_ptr<Device>> devices;
+    for (const auto& name : opt.ports) {
+        devices.emplace_back(new Device());
+        Device& dev = *devices.back();
+        dev.index = (uint8_t)(devices.size() - 1);
+        dev.port_name = name;
+        dev.baud = opt.baud;
+        if (!dev.port.open(name, dev.baud)) {
+            std::fprintf(stderr, "Failed to open %s\n", dev.port.last_error().c_str());
+            return 1;
         }
+        dev.board_id = dev.port.name();
     }
 
-    std::fclose(f);
-    CloseHandle(h);
+    if (opt.calibrate) {
+        return run_calibration(*devices[0], opt.calibrate_s);
+    }
+
+    Session session;
+    session.status = opt.status;
+    const bool binary = opt.format == "bin";
+    std::string out_path;
+    session.f = create_session_file(opt.out_dir, opt.session_id, binary ? ".col" : ".csv", out_path);
+    if (!session.f) {
+        std::fprintf(stderr, "Failed to create output file: %s\n", out_path.c_str());
+        return 1;
+    }
+
+    // Pair wall clock and monotonic clock once per session
+    char wall[32];
+    timestamp_iso_ms(wall, sizeof(wall));
+    const uint64_t session_mono_ns = mono_now_ns();
+    if (binary) {
+        session.bin.reset(new ColumnarWriter());
+        if (!session.bin->open(session.f, session_meta(opt.session_id, wall, session_mono_ns, devices))) {
+            std::fprintf(stderr, "Failed to write %s\n", out_path.c_str());
+            return 1;
+        }
+    } else {
+        std::fprintf(session.f, "arrival_ns,line_type,us_value,gpio,dropped,text,device,segment\n");
+        Record r;
+        const std::string text = "id=" + opt.session_id + " wall=" + wall;
+        r.text = text;
+        std::string row;
+        append_row(row, session_mono_ns, kRowSession, r, std::string_view(), 0);
+        std::fwrite(row.data(), 1, row.size(), session.f);
+    }
+    std::fflush(session.f);
+
+    for (auto& dev : devices) {
+        std::fprintf(stderr, "Logging from %s at %lu baud to %s\n",
+                     dev->port.name().c_str(), (unsigned long)dev->baud, out_path.c_str());
+    }
+    if (opt.duration_s > 0) {
+        std::fprintf(stderr, "Line-based parsing (split on \\n). Stopping after %g s or Ctrl+C.\n",
+                     opt.duration_s);
+    } else {
+        std::fprintf(stderr, "Line-based parsing (split on \\n). Ctrl+C to stop.\n");
+    }
+
+    std::vector<std::thread> readers;
+    for (auto& dev : devices) {
+        Device* d = dev.get();
+        readers.emplace_back([d] { read_device(*d); });
+    }
+    std::thread writer([&devices, &session] { write_session(devices, session); });
+
+    if (opt.duration_s > 0) {
+        const double end_s = mono_now_s() + opt.duration_s;
+        while (!g_stop && mono_now_s() < end_s) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        g_stop.store(true);
+    }
+
+    for (auto& t : readers) t.join();
+    writer.join();
+
+    if (session.bin) {
+        if (!session.bin->close(session_meta(opt.session_id, wall, session_mono_ns, devices))) {
+            std::fprintf(stderr, "Failed to write %s\n", out_path.c_str());
+        }
+        std::fprintf(stderr, "%llu rows in %s\n",
+                     (unsigned long long)session.bin->total_rows(), out_path.c_str());
+    }
+    std::fclose(session.f);
+    for (auto& dev : devices) {
+        dev->port.close();
+        dev->stats.print_summary(stderr, dev->board_id.c_str(), dev->segment);
+        char errors[192];
+        format_errors(*dev, errors, sizeof(errors));
+        std::fprintf(stderr, "%s: %llu data lines in %u segment(s), %u reconnect(s)\n  %s\n",
+                     dev->board_id.c_str(), (unsigned long long)dev->data_lines,
+                     dev->segment + 1, dev->reconnects, errors);
+    }
     std::fprintf(stderr, "Stopped.\n");
     return 0;
 }
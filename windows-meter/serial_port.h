@@ -0,0 +1,334 @@
+// serial_port.h
+// Byte transport for the Pico's USB CDC-ACM port, kept apart from the
+// capture logic in serial_logger.cpp.
+//  - Windows: Win32 comm API. Timeouts are set so ReadFile returns as soon as
+//    any byte is queued instead of waiting out an inter-byte interval.
+//  - Linux:   termios in raw mode + poll(), i.e. readiness driven.
+// read() waits at most timeout_ms and returns the byte count, 0 on timeout
+// and -1 on error (see last_error()).
+// error_counters() reports line errors the driver saw since open(): on Windows
+// from ClearCommError (flags, so at most one per kind per call), on Linux from
+// the TIOCGICOUNT counters where the driver keeps them (cdc-acm, UARTs).
+// serial_port_test.cpp checks the Linux backend through a pseudo-terminal.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
+#endif
+
+#ifdef _WIN32
+#define SERIAL_DEFAULT_PORT "COM9"
+#else
+#define SERIAL_DEFAULT_PORT "/dev/ttyACM0"
+#endif
+
+struct SerialErrors {
+    uint64_t overrun = 0;       // UART/driver could not keep up
+    uint64_t rx_overflow = 0;   // receive queue full, bytes discarded
+    uint64_t framing = 0;
+    uint64_t parity = 0;
+    uint64_t brk = 0;
+};
+
+class SerialPort {
+public:
+    SerialPort() = default;
+    SerialPort(const SerialPort&) = delete;
+    SerialPort& operator=(const SerialPort&) = delete;
+    ~SerialPort() { close(); }
+
+    // "COM9", "\\.\COM9" or "/dev/ttyACM0"
+    bool open(const std::string& name, uint32_t baud);
+    void close();
+    bool is_open() const;
+
+    long read(void* buf, size_t len, int timeout_ms);
+    bool write(const void* buf, size_t len);
+
+    // Cumulative since open(); false if the driver keeps no such counters
+    bool error_counters(SerialErrors& out);
+
+    const std::string& name() const { return name_; }
+    const std::string& last_error() const { return error_; }
+
+private:
+    void set_error(const char* what);
+
+    std::string name_;
+    std::string error_;
+#ifdef _WIN32
+    HANDLE h_ = INVALID_HANDLE_VALUE;
+    int timeout_ms_ = -1;   // timeout currently programmed into the driver
+    SerialErrors errors_;
+#else
+    int fd_ = -1;
+    bool have_icount_ = false;
+#ifdef __linux__
+    struct serial_icounter_struct icount_base_{};
+#endif
+#endif
+};
+
+#ifdef _WIN32
+
+inline void SerialPort::set_error(const char* what) {
+    char buf[128];
+    std::snprintf(buf, sizeof(buf), "%s failed on %s (err=%lu)",
+                  what, name_.c_str(), GetLastError());
+    error_ = buf;
+}
+
+inline bool SerialPort::open(const std::string& name, uint32_t baud) {
+    close();
+    name_ = name.rfind("\\\\.\\", 0) == 0 ? name.substr(4) : name;
+    const std::string path = "\\\\.\\" + name_;
+
+    h_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                     OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (h_ == INVALID_HANDLE_VALUE) {
+        set_error("CreateFileA");
+        return false;
+    }
+
+    DCB dcb{};
+    dcb.DCBlength = sizeof(dcb);
+    if (!GetCommState(h_, &dcb)) {
+        set_error("GetCommState");
+        close();
+        return false;
+    }
+
+    dcb.BaudRate = baud;
+    dcb.ByteSize = 8;
+    dcb.Parity   = NOPARITY;
+    dcb.StopBits = ONESTOPBIT;
+
+    // No flow control
+    dcb.fOutxCtsFlow = FALSE;
+    dcb.fOutxDsrFlow = FALSE;
+    dcb.fDtrControl  = DTR_CONTROL_ENABLE;
+    dcb.fRtsControl  = RTS_CONTROL_ENABLE;
+    dcb.fOutX        = FALSE;
+    dcb.fInX         = FALSE;
+
+    if (!SetCommState(h_, &dcb)) {
+        set_error("SetCommState");
+        close();
+        return false;
+    }
+
+    SetupComm(h_, 1 << 16, 1 << 16);
+    PurgeComm(h_, PURGE_RXCLEAR | PURGE_TXCLEAR);
+    timeout_ms_ = -1;
+    errors_ = SerialErrors();
+    DWORD flags;
+    ClearCommError(h_, &flags, nullptr);   // drop whatever predates this session
+    return true;
+}
+
+inline void SerialPort::close() {
+    if (h_ != INVALID_HANDLE_VALUE) CloseHandle(h_);
+    h_ = INVALID_HANDLE_VALUE;
+}
+
+inline bool SerialPort::is_open() const {
+    return h_ != INVALID_HANDLE_VALUE;
+}
+
+inline long SerialPort::read(void* buf, size_t len, int timeout_ms) {
+    if (timeout_ms != timeout_ms_) {
+        // MAXDWORD/MAXDWORD/constant: return immediately when bytes are
+        // queued, otherwise wait for the first byte up to the constant
+        COMMTIMEOUTS to{};
+        to.ReadIntervalTimeout        = MAXDWORD;
+        to.ReadTotalTimeoutMultiplier = MAXDWORD;
+        to.ReadTotalTimeoutConstant   = (DWORD)timeout_ms;
+        if (!SetCommTimeouts(h_, &to)) {
+            set_error("SetCommTimeouts");
+            return -1;
+        }
+        timeout_ms_ = timeout_ms;
+    }
+
+    DWORD read_n = 0;
+    if (!ReadFile(h_, buf, (DWORD)len, &read_n, nullptr)) {
+        set_error("ReadFile");
+        return -1;
+    }
+    return (long)read_n;
+}
+
+inline bool SerialPort::write(const void* buf, size_t len) {
+    DWORD written = 0;
+    if (!WriteFile(h_, buf, (DWORD)len, &written, nullptr) || written != (DWORD)len) {
+        set_error("WriteFile");
+        return false;
+    }
+    return true;
+}
+
+inline bool SerialPort::error_counters(SerialErrors& out) {
+    DWORD flags = 0;
+    COMSTAT stat{};
+    if (!ClearCommError(h_, &flags, &stat)) {
+        set_error("ClearCommError");
+        return false;
+    }
+    if (flags & CE_OVERRUN)  errors_.overrun++;
+    if (flags & CE_RXOVER)   errors_.rx_overflow++;
+    if (flags & CE_FRAME)    errors_.framing++;
+    if (flags & CE_RXPARITY) errors_.parity++;
+    if (flags & CE_BREAK)    errors_.brk++;
+    out = errors_;
+    return true;
+}
+
+#else
+
+inline void SerialPort::set_error(const char* what) {
+    error_ = std::string(what) + " failed on " + name_ + ": " + std::strerror(errno);
+}
+
+static inline speed_t serial_baud_constant(uint32_t baud) {
+    switch (baud) {
+    case 9600:   return B9600;
+    case 19200:  return B19200;
+    case 38400:  return B38400;
+    case 57600:  return B57600;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default:     return B115200;   // CDC-ACM ignores the rate anyway
+    }
+}
+
+inline bool SerialPort::open(const std::string& name, uint32_t baud) {
+    close();
+    name_ = name;
+
+    fd_ = ::open(name_.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) {
+        set_error("open");
+        return false;
+    }
+
+    struct termios tio;
+    if (tcgetattr(fd_, &tio) != 0) {
+        set_error("tcgetattr");
+        close();
+        return false;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~CRTSCTS;       // no flow control
+    tio.c_cc[VMIN]  = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, serial_baud_constant(baud));
+    cfsetospeed(&tio, serial_baud_constant(baud));
+    if (tcsetattr(fd_, TCSANOW, &tio) != 0) {
+        set_error("tcsetattr");
+        close();
+        return false;
+    }
+
+    tcflush(fd_, TCIOFLUSH);
+#ifdef __linux__
+    have_icount_ = ioctl(fd_, TIOCGICOUNT, &icount_base_) == 0;
+#endif
+    return true;
+}
+
+inline void SerialPort::close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+}
+
+inline bool SerialPort::is_open() const {
+    return fd_ >= 0;
+}
+
+inline long SerialPort::read(void* buf, size_t len, int timeout_ms) {
+    struct pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    int rc = ::poll(&pfd, 1, timeout_ms);
+    if (rc < 0) {
+        if (errno == EINTR) return 0;
+        set_error("poll");
+        return -1;
+    }
+    if (rc == 0) return 0;
+    if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        errno = (pfd.revents & POLLNVAL) ? EBADF : EIO;
+        set_error("poll");
+        return -1;
+    }
+
+    ssize_t n = ::read(fd_, buf, len);
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EINTR) return 0;
+        set_error("read");
+        return -1;
+    }
+    return (long)n;
+}
+
+inline bool SerialPort::write(const void* buf, size_t len) {
+    const char* p = (const char*)buf;
+    while (len > 0) {
+        ssize_t n = ::write(fd_, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) {
+                struct pollfd pfd = { fd_, POLLOUT, 0 };
+                ::poll(&pfd, 1, 100);
+                continue;
+            }
+            set_error("write");
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+inline bool SerialPort::error_counters(SerialErrors& out) {
+#ifdef __linux__
+    struct serial_icounter_struct ic{};
+    if (!have_icount_ || ioctl(fd_, TIOCGICOUNT, &ic) != 0) return false;
+    out.overrun     = (uint64_t)(uint32_t)(ic.overrun - icount_base_.overrun);
+    out.rx_overflow = (uint64_t)(uint32_t)(ic.buf_overrun - icount_base_.buf_overrun);
+    out.framing     = (uint64_t)(uint32_t)(ic.frame - icount_base_.frame);
+    out.parity      = (uint64_t)(uint32_t)(ic.parity - icount_base_.parity);
+    out.brk         = (uint64_t)(uint32_t)(ic.brk - icount_base_.brk);
+    return true;
+#else
+    (void)out;
+    return false;
+#endif
+}
+
+#endif
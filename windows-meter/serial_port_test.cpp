@@ -0,0 +1,331 @@
+// serial_port_test.cpp
+// Drives the Linux SerialPort backend (serial_port.h) through a
+// pseudo-terminal: the test holds the master side and plays the Pico, the
+// SerialPort under test opens the slave like /dev/ttyACM0. The Pico side
+// sends what pico/main.c sends (session header, batch tags, events,
+// heartbeats and load reports, with stdio's CRLF line ends), and what comes
+// out of the port is split and parsed the way serial_logger does
+// (line_splitter.h, pico_protocol.h). Checks raw mode (no byte is translated
+// or eaten), that read() returns as soon as bytes are ready instead of
+// batching, the timeout, commands towards the device, a burst larger than
+// the tty buffers, and hangup.
+//
+// Build (Linux): g++ -std=c++17 -O2 -Wall serial_port_test.cpp -o serial_port_test
+// Run: serial_port_test   (exit code 0 when every check passes)
+
+#ifdef _WIN32
+#include <cstdio>
+int main() {
+    std::printf("serial_port_test needs a pseudo-terminal (Linux)\n");
+    return 0;
+}
+#else
+
+#include "host_clock.h"
+#include "line_splitter.h"
+#include "pico_protocol.h"
+#include "serial_port.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ---- The Pico side ----
+// Lines as pico/main.c formats them. stdio turns every "\n" into "\r\n", and
+// each USB write starts with a "Batch=<seq> Board=<id>" tag line.
+
+static const char kBoard[] = "E6605838833C2A2F";
+static const unsigned kPins[] = { 0, 1, 2, 3, 4, 5, 10, 11, 12, 13, 14, 15, 16 };
+static const size_t kLineTypes = (size_t)LineType::Hello + 1;
+
+struct PicoStream {
+    std::string bytes;
+    uint64_t us = 10037126;
+    size_t pin = 0;
+    unsigned batch_seq = 0;
+    size_t counts[kLineTypes] = {};     // lines sent, by the type they must parse as
+
+    void line(LineType type, const std::string& text) {
+        bytes += text;
+        bytes += "\r\n";
+        counts[(size_t)type]++;
+    }
+
+    // What main() sends before the first event
+    void session_header() {
+        line(LineType::Info, "Pico multi-GPIO actuator started. Interval=35 ms, duration=5 ms");
+        line(LineType::Board, std::string("Board=") + kBoard);
+        batch();
+        line(LineType::Hello, std::string("Hello proto=1 enc=text fw=multi-gpio-actuator board=") + kBoard +
+                                  " pins=0,1,2,3,4,5,10,11,12,13,14,15,16 interval_ms=35 pulse_ms=5"
+                                  " queue=128 clock=us");
+        line(LineType::Cal, "Calibration ppb=-1234");
+    }
+
+    void batch() { line(LineType::Batch, "Batch=" + std::to_string(batch_seq++) + " Board=" + kBoard); }
+
+    void event() {
+        line(LineType::Data, std::to_string(us) + " us GPIO" + std::to_string(kPins[pin]));
+        us += 35000;
+        pin = (pin + 1) % (sizeof(kPins) / sizeof(kPins[0]));
+    }
+
+    void heartbeat(unsigned dropped) {
+        line(LineType::Heartbeat, "Heartbeat. Dropped=" + std::to_string(dropped));
+    }
+
+    void load() {
+        line(LineType::Load, "Load core=0 total=125000000 sched=41250 drain=183420 usb=2210344 hb=1896"
+                             " cmd=412 idle=122562682 max_loop=20344 long=0");
+    }
+};
+
+// Splits and parses what the port delivers, as serial_logger does. bad
+// counts lines of a known kind that did not parse completely.
+struct PicoParser {
+    LineSplitter lines;
+    size_t counts[kLineTypes] = {};
+    size_t bad = 0;
+    Record hello;
+
+    void feed(const std::string& bytes) {
+        size_t at = 0;
+        while (at < bytes.size()) {
+            const size_t n = std::min(lines.write_space(), bytes.size() - at);
+            std::memcpy(lines.write_ptr(), bytes.data() + at, n);
+            lines.commit(n);
+            at += n;
+            lines.drain([&](std::string_view line) {
+                const Record r = parse_line(line);
+                counts[(size_t)r.type]++;
+                if (r.type == LineType::Data && (r.gpio < 0 || !r.text.empty())) bad++;
+                if (r.type == LineType::Heartbeat && r.dropped < 0) bad++;
+                if (r.type == LineType::Batch && r.board != kBoard) bad++;
+                if (r.type == LineType::Hello) hello = r;
+            });
+        }
+    }
+};
+
+// Master side of a pty; slave_path is what a SerialPort opens
+struct Pty {
+    int master = -1;
+    std::string slave_path;
+
+    bool open() {
+        master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+        if (master >= 0) fcntl(master, F_SETFL, O_NONBLOCK);   // the burst writes while the port reads
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return false;
+        const char* name = ptsname(master);
+        if (!name) return false;
+        // The pair shares one termios, left at its cooked defaults here so
+        // that only SerialPort::open() can make the line raw
+        slave_path = name;
+        return true;
+    }
+
+    void close() {
+        if (master >= 0) ::close(master);
+        master = -1;
+    }
+
+    ~Pty() { close(); }
+
+    bool send(const void* p, size_t n) {
+        const char* c = (const char*)p;
+        while (n > 0) {
+            ssize_t w = ::write(master, c, n);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN) {
+                    struct pollfd pfd = { master, POLLOUT, 0 };
+                    ::poll(&pfd, 1, 100);
+                    continue;
+                }
+                return false;
+            }
+            c += w;
+            n -= (size_t)w;
+        }
+        return true;
+    }
+
+    bool send(const std::string& s) { return send(s.data(), s.size()); }
+
+    // Reads until n bytes arrived or timeout_ms passed without any
+    std::string receive(size_t n, int timeout_ms) {
+        std::string out;
+        char buf[4096];
+        while (out.size() < n) {
+            struct pollfd pfd = { master, POLLIN, 0 };
+            if (::poll(&pfd, 1, timeout_ms) <= 0) break;
+            ssize_t r = ::read(master, buf, sizeof(buf));
+            if (r <= 0) break;
+            out.append(buf, (size_t)r);
+        }
+        return out;
+    }
+};
+
+// Reads from the port until n bytes arrived or a read times out
+static std::string read_port(SerialPort& port, size_t n, int timeout_ms) {
+    std::string out;
+    char buf[4096];
+    while (out.size() < n) {
+        long r = port.read(buf, sizeof(buf), timeout_ms);
+        if (r <= 0) break;
+        out.append(buf, (size_t)r);
+    }
+    return out;
+}
+
+static void test_open_missing() {
+    SerialPort port;
+    CHECK(!port.open("/dev/serial_port_test_missing", 115200), "opened a missing device");
+    CHECK(!port.is_open(), "is_open after a failed open");
+    CHECK(!port.last_error().empty(), "no error text");
+}
+
+// Control characters and 8-bit bytes must come through as sent: no CR/NL
+// translation, no signals (^C), no flow control (^S/^Q), no line editing
+static void test_raw_bytes(Pty& pty, SerialPort& port) {
+    std::string all;
+    for (int i = 0; i < 256; i++) all.push_back((char)i);
+    CHECK(pty.send(all), "send failed");
+    const std::string got = read_port(port, all.size(), 500);
+    CHECK(got == all, "got %zu of %zu bytes back, first difference at %zu", got.size(), all.size(),
+          (size_t)(std::mismatch(got.begin(), got.end(), all.begin()).first - got.begin()));
+}
+
+// The session header arrives byte for byte and parses into its line kinds
+static void test_session_header(Pty& pty, SerialPort& port) {
+    PicoStream pico;
+    pico.session_header();
+    CHECK(pty.send(pico.bytes), "send failed");
+    const std::string got = read_port(port, pico.bytes.size(), 500);
+    CHECK(got == pico.bytes, "got %zu of %zu bytes", got.size(), pico.bytes.size());
+
+    PicoParser parser;
+    parser.feed(got);
+    for (size_t t = 0; t < kLineTypes; t++) {
+        CHECK(parser.counts[t] == pico.counts[t], "%s: %zu lines, sent %zu",
+              line_type_name((LineType)t), parser.counts[t], pico.counts[t]);
+    }
+    CHECK(parser.bad == 0, "%zu lines did not parse completely", parser.bad);
+    CHECK(select_decoder(parser.hello.proto, parser.hello.encoding) == parse_line,
+          "hello proto=%d enc=%.*s not decodable", parser.hello.proto,
+          (int)parser.hello.encoding.size(), parser.hello.encoding.data());
+}
+
+// A single event is handed over at once, not after an inter-byte interval
+static void test_readiness(Pty& pty, SerialPort& port) {
+    std::vector<double> delays_ms;
+    PicoStream pico;
+    for (int i = 0; i < 20; i++) {
+        pico.bytes.clear();
+        pico.event();
+        const uint64_t t0 = mono_now_ns();
+        pty.send(pico.bytes);
+        const std::string got = read_port(port, pico.bytes.size(), 1000);
+        delays_ms.push_back((double)(mono_now_ns() - t0) * 1e-6);
+        CHECK(got == pico.bytes, "round %d: got \"%s\"", i, got.c_str());
+    }
+    std::sort(delays_ms.begin(), delays_ms.end());
+    // The Win32 backend used to batch for 50 ms; readiness is far below that
+    CHECK(delays_ms[delays_ms.size() / 2] < 10.0, "median delay %.3f ms", delays_ms[delays_ms.size() / 2]);
+}
+
+static void test_timeout(SerialPort& port) {
+    char buf[16];
+    const uint64_t t0 = mono_now_ns();
+    const long r = port.read(buf, sizeof(buf), 50);
+    const double ms = (double)(mono_now_ns() - t0) * 1e-6;
+    CHECK(r == 0, "read returned %ld with nothing sent", r);
+    CHECK(ms >= 45.0 && ms < 500.0, "timeout took %.1f ms", ms);
+}
+
+// The commands serial_logger sends to the Pico
+static void test_write(Pty& pty, SerialPort& port) {
+    const std::string cmd = "HELLO\nSYNC\nCAL ppb=-1234\n";
+    CHECK(port.write(cmd.data(), cmd.size()), "%s", port.last_error().c_str());
+    const std::string got = pty.receive(cmd.size(), 500);
+    CHECK(got == cmd, "master got \"%s\"", got.c_str());
+}
+
+// More than the pty buffers at once, written while the port reads: batches
+// of events with heartbeats and load reports in between, as the firmware
+// sends them when the host falls behind
+static void test_burst(Pty& pty, SerialPort& port) {
+    PicoStream pico;
+    for (unsigned n = 0; pico.bytes.size() < (1u << 20); n++) {
+        if (n % 8 == 0) pico.batch();
+        pico.event();
+        if (n % 28 == 27) pico.heartbeat(n / 1000);
+        if (n % 1000 == 999) pico.load();
+    }
+    const std::string& burst = pico.bytes;
+    std::string got;
+    size_t sent = 0;
+    char buf[4096];
+    while (got.size() < burst.size()) {
+        if (sent < burst.size()) {
+            ssize_t w = ::write(pty.master, burst.data() + sent, std::min<size_t>(burst.size() - sent, 8192));
+            if (w > 0) sent += (size_t)w;
+        }
+        const long r = port.read(buf, sizeof(buf), sent < burst.size() ? 0 : 500);
+        if (r < 0 || (r == 0 && sent == burst.size())) break;
+        got.append(buf, (size_t)r);
+    }
+    CHECK(got == burst, "burst: %zu of %zu bytes, in order: %d", got.size(), burst.size(),
+          burst.compare(0, got.size(), got) == 0);
+
+    PicoParser parser;
+    parser.feed(got);
+    for (size_t t = 0; t < kLineTypes; t++) {
+        CHECK(parser.counts[t] == pico.counts[t], "burst %s: %zu lines, sent %zu",
+              line_type_name((LineType)t), parser.counts[t], pico.counts[t]);
+    }
+    CHECK(parser.bad == 0, "burst: %zu lines did not parse completely", parser.bad);
+}
+
+// Unplugging the Pico: the port reports an error instead of timing out forever
+static void test_hangup(Pty& pty, SerialPort& port) {
+    pty.close();
+    char buf[16];
+    long r = 0;
+    for (int i = 0; i < 5 && r == 0; i++) r = port.read(buf, sizeof(buf), 100);
+    CHECK(r < 0, "read returned %ld after hangup", r);
+    CHECK(!port.last_error().empty(), "no error text after hangup");
+}
+
+int main() {
+    test_open_missing();
+
+    Pty pty;
+    if (!pty.open()) {
+        std::printf("FAIL: cannot create a pseudo-terminal: %s\n", std::strerror(errno));
+        return 1;
+    }
+    SerialPort port;
+    if (!port.open(pty.slave_path, 115200)) {
+        std::printf("FAIL: %s\n", port.last_error().c_str());
+        return 1;
+    }
+
+    test_raw_bytes(pty, port);
+    test_session_header(pty, port);
+    test_readiness(pty, port);
+    test_timeout(port);
+    test_write(pty, port);
+    test_burst(pty, port);
+    test_hangup(pty, port);
+
+    port.close();
+    return test_result("serial_port_test");
+}
+
+#endif
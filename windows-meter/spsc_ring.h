@@ -0,0 +1,83 @@
+// spsc_ring.h
+// Bounded lock-free single-producer/single-consumer ring.
+// Slots are preallocated; the producer can fill a slot in place
+// (begin_push/end_push) and the consumer can read it in place (front/pop),
+// so large records such as read chunks are never copied through the ring.
+// Indices run freely and are masked on access; capacity must be a power of two.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template <class T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) : slots_(capacity), mask_(capacity - 1) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return slots_.size(); }
+
+    // ---- Producer side ----
+
+    // Free slot to fill, nullptr if the ring is full
+    T* begin_push() {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ == slots_.size()) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ == slots_.size()) return nullptr;
+        }
+        return &slots_[head & mask_];
+    }
+
+    // Publishes the slot returned by begin_push()
+    void end_push() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool try_push(const T& v) {
+        T* slot = begin_push();
+        if (!slot) return false;
+        *slot = v;
+        end_push();
+        return true;
+    }
+
+    // ---- Consumer side ----
+
+    // Oldest published slot, nullptr if the ring is empty
+    T* front() {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cached_head_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail == cached_head_) return nullptr;
+        }
+        return &slots_[tail & mask_];
+    }
+
+    // Releases the slot returned by front()
+    void pop() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool try_pop(T& out) {
+        T* slot = front();
+        if (!slot) return false;
+        out = *slot;
+        pop();
+        return true;
+    }
+
+private:
+    std::vector<T> slots_;
+    const size_t mask_;
+
+    // Producer and consumer indices on separate cache lines
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t cached_tail_ = 0;                    // producer's view of tail_
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t cached_head_ = 0;                    // consumer's view of head_
+};
@@ -0,0 +1,29 @@
+// test_check.h
+// Check scaffold shared by the *_test.cpp programs. CHECK(cond, fmt, ...)
+// prints the failed condition with its location and message and carries
+// on; test_result() prints the summary and is main()'s exit code.
+
+#pragma once
+
+#include <cstdio>
+
+static int test_failures = 0;
+
+#define CHECK(cond, ...)                                                \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            std::printf("FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+            std::printf(__VA_ARGS__);                                   \
+            std::printf("\n");                                          \
+            test_failures++;                                            \
+        }                                                               \
+    } while (0)
+
+static inline int test_result(const char* name) {
+    if (test_failures) {
+        std::printf("%s: %d check(s) failed\n", name, test_failures);
+        return 1;
+    }
+    std::printf("%s: all checks passed\n", name);
+    return 0;
+}